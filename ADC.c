@@ -5,61 +5,388 @@
  * This has everything needed to configure the ADC for
  * 10 bit operation and reading the values.
  *
+ * The ISR scans a list of channels round-robin and stores each result in
+ * a per-channel snapshot, so reading a channel never switches the mux or
+ * waits on a conversion. Channels can be oversampled for extra bits of
+ * resolution, which the ISR does by summing a burst of conversions on the
+ * same channel before it moves the mux. Sweeps of the list either run back
+ * to back or get started by the Timer0 compare match of the control tick.
+ * With the tick starting them, channels that don't need to be in step with
+ * the tick can be left out of the sweep and converted in the background
+ * between sweeps, as long as each conversion finishes before the next tick.
+ * Channels can also be watched for threshold crossings, which the ISR
+ * stamps with the Timer0 count as it publishes the sample. Snapshots are
+ * guarded by a sequence counter instead of cli()/sei() so readers never add
+ * jitter to the timer ISR.
  *
  * @author cpbove@wpi.edu
  * @date 28-Jan-2016
- * @version 1.0
+ * @version 1.1
  */
 
 #include "RBELib/RBELib.h"
 #include "include/definitions.h" // our definitions
+#include "include/ADC.h"
+#include "include/arm.h" // for timerCount
 
 /**
- * @var adch
- * for storing the adch register value after an interrupt
+ * @struct adcRecord
+ * a channel's latest sample plus the sequence counter guarding it
  *
- * @var adcl
- * for storing the adch register value after an interrupt
+ * @var adcRecord::seq
+ * bumped by the ISR before and after it writes the sample
+ * @var adcRecord::sample
+ * the published sample
+ * @var adcRecord::conversions
+ * conversions finished on the channel, counting each oversample
+ */
+typedef struct {
+	volatile unsigned char seq;
+	volatile adcSample sample;
+	volatile unsigned long conversions;
+} adcRecord;
+
+/**
+ * @var adcRecords
+ * latest sample of each channel, written by the ISR
+ *
+ * @var adcValidMask
+ * bit n is set once channel n has been converted at least once
+ *
+ * @var adcScanMask
+ * bit n is set if channel n is in the scan list
+ *
+ * @var adcReads
+ * reads of each channel through getADC or getADCSample
+ *
+ * @var adcReadRetries
+ * times a reader of each channel saw the ISR publish mid-copy and retried
+ *
+ * @var adcStallCounts
+ * Timer0 counts getADC spent waiting on each channel's first sample
+ */
+adcRecord adcRecords[ADC_NUM_CHANNELS];
+volatile unsigned char adcValidMask;
+volatile unsigned char adcScanMask;
+unsigned long adcReads[ADC_NUM_CHANNELS];
+unsigned long adcReadRetries[ADC_NUM_CHANNELS];
+unsigned long adcStallCounts[ADC_NUM_CHANNELS];
+
+/**
+ * @var oversampleBits
+ * extra bits of resolution each channel is oversampled to
+ *
+ * @var accum
+ * running sum of the conversions in the current oversample burst
+ *
+ * @var accumCount
+ * conversions summed into accum so far
+ */
+volatile unsigned char oversampleBits[ADC_NUM_CHANNELS];
+unsigned short accum[ADC_NUM_CHANNELS];
+unsigned char accumCount[ADC_NUM_CHANNELS];
+
+/**
+ * @var scanList
+ * channels the ISR cycles through, in order
+ *
+ * @var scanLength
+ * number of channels in scanList
+ *
+ * @var scanIndex
+ * index in scanList of the channel being converted
+ *
+ * @var convertingChannel
+ * channel the running conversion belongs to
+ */
+volatile unsigned char scanList[ADC_MAX_SCAN];
+volatile unsigned char scanLength;
+volatile unsigned char scanIndex;
+volatile unsigned char convertingChannel;
+
+/**
+ * @var adcTrigger
+ * what starts each sweep, one of the adcTriggers
  *
- * @var readNewChannel
- * used to make sure we read the new channel after we switch channels
+ * @var sweepCount
+ * number of completed sweeps of the scan list
+ *
+ * @var lastSweepSeen
+ * sweepCount the last time adcSweepReady said yes
+ */
+volatile unsigned char adcTrigger;
+volatile unsigned long sweepCount;
+unsigned long lastSweepSeen;
+
+/**
+ * @var backgroundMask
+ * bit n is set if channel n is converted between triggered sweeps instead
+ * of in them
+ *
+ * @var backgroundIndex
+ * index in scanList of the background channel being converted, or next up
+ *
+ * @var backgroundTick
+ * timerCount when the ADC last went over to the background, a tick since
+ * then means the sweep is due
+ *
+ * @var sweepRunning
+ * TRUE while the ISR is working through a triggered sweep, or waiting for
+ * the tick to start one
+ */
+volatile unsigned char backgroundMask;
+volatile unsigned char backgroundIndex;
+unsigned long backgroundTick;
+volatile BOOL sweepRunning;
+
+/**
+ * @var edgeMask
+ * bit n is set if channel n is watched for edges
+ *
+ * @var edgeAbove
+ * bit n is set while channel n is above its thresholds
+ *
+ * @var edgeHigh
+ * 10 bit reading each channel has to reach for a rising edge
+ *
+ * @var edgeLow
+ * 10 bit reading each channel has to drop below for a falling edge
+ *
+ * @var edgeQueue
+ * edges the ISR found, oldest at edgeHead
+ *
+ * @var edgeHead
+ * index in edgeQueue of the oldest edge
+ *
+ * @var edgeTail
+ * index in edgeQueue the ISR puts the next edge at
  */
-volatile unsigned short adch;
-volatile unsigned short adcl;
-volatile unsigned short readNewChannel;
+volatile unsigned char edgeMask;
+unsigned char edgeAbove;
+unsigned short edgeHigh[ADC_NUM_CHANNELS];
+unsigned short edgeLow[ADC_NUM_CHANNELS];
+adcEdge edgeQueue[ADC_EDGE_QUEUE_SIZE];
+volatile unsigned char edgeHead;
+volatile unsigned char edgeTail;
+
+/**
+ * @brief gets a fine grained time stamp
+ *
+ * @return Timer0 counts (1024 clocks each) since setupTimer
+ */
+unsigned long adcClock(){
+	unsigned long ticks;
+	unsigned char counts;
+	// re-read if the tick ISR ran between the two reads
+	do {
+		ticks = timerCount;
+		counts = TCNT0;
+		// the counter wrapped but the tick ISR hasn't run yet, which is
+		// always the case when this is called from another ISR
+		if(TIFR0 & BIT(OCF0A)){
+			ticks++;
+			counts = TCNT0;
+		}
+	} while(ticks != timerCount);
+	return ticks * (OCR0A + 1) + counts;
+}
+
+/**
+ * @brief checks a freshly published sample against its channel's edge
+ * thresholds and queues an edge if it crossed one. Called from the ISR.
+ * @param channel the channel the sample is from
+ * @param value the sample, 10 bits plus bits of oversampling
+ * @param bits extra bits of resolution in the value
+ */
+void checkADCEdge(unsigned char channel, unsigned short value, unsigned char bits){
+	BOOL above = (edgeAbove & BIT(channel)) != 0;
+	value >>= bits;
+	if(above ? value >= edgeLow[channel] : value < edgeHigh[channel])
+		return;
+	edgeAbove ^= BIT(channel);
+	unsigned char next = (edgeTail + 1) & (ADC_EDGE_QUEUE_SIZE - 1);
+	if(next == edgeHead)
+		return; // full, nobody is reading them
+	edgeQueue[edgeTail].channel = channel;
+	edgeQueue[edgeTail].rising = !above;
+	edgeQueue[edgeTail].clock = adcClock();
+	edgeTail = next;
+}
+
+/**
+ * @brief checks if a background conversion started now would finish before
+ * the next Timer0 compare match starts a sweep. Called from the ISR.
+ *
+ * @return TRUE if there is time for one more conversion
+ */
+BOOL adcTimeBeforeSweep(){
+	if(backgroundTick != timerCount || (TIFR0 & BIT(OCF0A)))
+		return FALSE; // the tick is already here
+	return (int)OCR0A - TCNT0 > ADC_BACKGROUND_COUNTS;
+}
+
+/**
+ * @brief sets the mux to the first channel of the sweep and leaves the ADC
+ * for the tick to start. Called from the ISR.
+ * @details if a tick came while a background conversion was running, its
+ * trigger was lost, so the sweep starts straight away instead
+ * @param afterBackground TRUE if the ADC was just converting a background
+ * channel
+ */
+void waitForADCSweep(BOOL afterBackground){
+	scanIndex = 0;
+	while(scanIndex < scanLength - 1 && (backgroundMask & BIT(scanList[scanIndex])))
+		scanIndex++;
+	convertingChannel = scanList[scanIndex];
+	changeADC(convertingChannel);
+	sweepRunning = TRUE;
+	if(afterBackground && (backgroundTick != timerCount || (TIFR0 & BIT(OCF0A))))
+		ADCSRA |= BIT(ADSC);
+}
+
+/**
+ * @brief starts the next conversion with the tick starting the sweeps: the
+ * rest of the sweep, then background channels until the next tick is too
+ * close. Called from the ISR once a sample is published.
+ */
+void nextTriggeredConversion(){
+	BOOL afterBackground = !sweepRunning;
+	unsigned char i;
+	if(sweepRunning){
+		// next channel of the sweep, the background ones aren't in it
+		do {
+			scanIndex++;
+		} while(scanIndex < scanLength && (backgroundMask & BIT(scanList[scanIndex])));
+		if(scanIndex < scanLength){
+			convertingChannel = scanList[scanIndex];
+			changeADC(convertingChannel);
+			ADCSRA |= BIT(ADSC);
+			return;
+		}
+		sweepRunning = FALSE;
+		sweepCount++;
+		backgroundTick = timerCount; // the background has until the next one
+	}
+	else if(++backgroundIndex >= scanLength)
+		backgroundIndex = 0; // that one is published, on to the next
+
+	if(!backgroundMask || !adcTimeBeforeSweep()){
+		waitForADCSweep(afterBackground);
+		return;
+	}
+	// carry on with the background channel whose burst is due
+	for(i = 0; i < scanLength && !(backgroundMask & BIT(scanList[backgroundIndex])); i++){
+		if(++backgroundIndex >= scanLength)
+			backgroundIndex = 0;
+	}
+	convertingChannel = scanList[backgroundIndex];
+	changeADC(convertingChannel);
+	ADCSRA |= BIT(ADSC);
+}
 
 /**
  * @brief ISR for updating ADC readings
- * Runs when ADC reading completes based on configured ADC settings
+ * Adds the finished conversion to its channel's burst, publishes the burst
+ * once it has 4^bits conversions, then starts the next channel in the list
  *
  * @param ADC_vect Interrupt vector for ADC on chip
  *
  */
 ISR(ADC_vect) {
-	adcl = ADCL; // set globals equal to register
-	adch = ADCH;
-	readNewChannel++; // increase read count
+	unsigned char low = ADCL; // ADCL has to be read before ADCH
+	unsigned char high = ADCH;
+	unsigned char bits = oversampleBits[convertingChannel];
+
+	// parse the 2 registers to get 1 10bit value and add it to the burst
+	accum[convertingChannel] += ((high & 0x3) << 8) | low;
+	accumCount[convertingChannel]++;
+	// stay on this channel until the burst has 4^bits conversions, a
+	// background burst stops for the sweep and carries on after it
+	if(accumCount[convertingChannel] < (1 << (2 * bits))){
+		if(adcTrigger == ADC_TIMER0_TRIGGER && !sweepRunning && !adcTimeBeforeSweep())
+			waitForADCSweep(TRUE);
+		else
+			ADCSRA |= BIT(ADSC);
+		return;
+	}
+
+	adcRecord *record = &adcRecords[convertingChannel];
+
+	// publish the sample, readers retry if seq moved while they copied
+	record->seq++;
+	record->sample.value = accum[convertingChannel] >> bits; // decimate
+	record->sample.bits = bits;
+	record->sample.count++;
+	record->sample.stamp = timerCount;
+	record->conversions += accumCount[convertingChannel];
+	record->seq++;
+	adcValidMask |= BIT(convertingChannel);
+	if(edgeMask & BIT(convertingChannel))
+		checkADCEdge(convertingChannel, record->sample.value, bits);
+	accum[convertingChannel] = 0; // start the next burst fresh
+	accumCount[convertingChannel] = 0;
+
+	if(adcTrigger == ADC_TIMER0_TRIGGER){
+		nextTriggeredConversion();
+		return;
+	}
+	// move on to the next channel in the list
+	scanIndex++;
+	if(scanIndex >= scanLength){
+		scanIndex = 0;
+		sweepCount++;
+	}
+	convertingChannel = scanList[scanIndex];
+	changeADC(convertingChannel);
+	ADCSRA |= BIT(ADSC); // start the next conversion
 }
 
 /**
- * @brief Initializes the ADC and makes one channel active.
+ * @brief Initializes the ADC and starts scanning the default channels.
  *
  * Enables ADC to use interrupts
  *
- * @param channel The ADC channel to initialize
+ * @param channel An ADC channel to scan along with the default list
  *
  */
 void initADC(int channel){
-	adch = 0; // init global
-	adcl = 0;
-	readNewChannel = 0;
+	const unsigned char defaultScan[] = ADC_DEFAULT_SCAN;
+	unsigned char i;
+	for(i = 0; i < ADC_NUM_CHANNELS; i++){ // init globals
+		adcRecords[i].seq = 0;
+		adcRecords[i].sample.value = 0;
+		adcRecords[i].sample.bits = 0;
+		adcRecords[i].sample.count = 0;
+		adcRecords[i].sample.stamp = 0;
+		adcRecords[i].conversions = 0;
+		accum[i] = 0;
+		accumCount[i] = 0;
+	}
+	adcValidMask = 0;
+	resetADCStats();
+	adcTrigger = ADC_FREE_RUN;
+	edgeMask = 0;
+	edgeHead = edgeTail = 0;
+	sweepCount = 0;
+	lastSweepSeen = 0;
+	backgroundMask = 0;
+	backgroundIndex = 0;
+	sweepRunning = FALSE;
+
 	ADCSRA |= BIT(ADPS2) | BIT(ADPS1) | BIT(ADPS0); // set division for sampling at 128kHz
 	ADMUX |= BIT(REFS0); //set voltage ref to AVCC=5V
 	//ADMUX |= BIT(ADLAR); //using 10-bit conversion, used to left-justify for 8 bit conversion
-	changeADC(channel);
 
-	ADCSRA |= BIT(ADATE); //set auto trigger on
-	ADCSRB &= ~(BIT(ADTS2)|BIT(ADTS1)|BIT(ADTS0));//set to free running
+	// single conversions, the ISR starts each one after switching the mux
+	ADCSRA &= ~BIT(ADATE);
+	// Timer0 compare match A if a triggered mode gets turned on
+	ADCSRB = (ADCSRB & ~(BIT(ADTS2)|BIT(ADTS1)|BIT(ADTS0))) | BIT(ADTS1) | BIT(ADTS0);
+	setADCScanList(defaultScan, ADC_DEFAULT_SCAN_LENGTH);
+	addADCScanChannel(channel);
+
+	scanIndex = 0;
+	convertingChannel = scanList[0];
+	changeADC(convertingChannel);
 
 	ADCSRA |= BIT(ADEN); // set enable bit
 	ADCSRA |= BIT(ADIE); //set ADC Interrupt on
@@ -79,11 +406,11 @@ void initADC(int channel){
  * calculation register and disconnect the input to the ADC if desired.
  */
 void clearADC(int channel){
-	ADCSRA &= ~BIT(ADEN); //disable ADC
+	ADCSRA &= ~(BIT(ADEN) | BIT(ADIE)); //disable ADC and its interrupt
 	ADCL = 0x00; // clear ADCL register Needed??
 	ADCH = 0x00; // clear ADCH register Needed??
-	adch = 0; // clear global
-	adcl = 0;
+	adcRecords[channel].sample.value = 0; // clear global
+	adcValidMask &= ~BIT(channel);
 	//ADCSRA &= ~ADIF; // clear ADIF
 	//channel = ~BIT(ADEN); // disable this channel
 
@@ -92,35 +419,62 @@ void clearADC(int channel){
 /**
  * @brief Get the analog value from the configured channel
  *
- * @param channel  The ADC channel to run a conversion on.
+ * Returns the latest snapshot from the scanner. A channel that isn't in the
+ * scan list gets added to it, and only that first call waits for a reading.
+ *
+ * @param channel  The ADC channel to read.
  * @return adcVal The 10 bit value returned by the ADC conversion.
+ * @note use getADCSample to get the full oversampled resolution
  *
  */
 unsigned short getADC(int channel){
-	static int lastChannel = 0;
-	// if the passed channel has changed since last time, change ADC channel
-	if(lastChannel != channel){
-		changeADC(channel); // change channel
-		lastChannel = channel;
-		readNewChannel = 0; // set this global to 0
-		// make sure we get latest reading from new channel
-		while(readNewChannel < 2){
-			//wait for ISR to run twice
-			// todo make this more intelligent
+	// start scanning a channel nobody asked for yet, then wait for it once
+	if(!(adcScanMask & BIT(channel))){
+		unsigned long stallStart = adcClock();
+		addADCScanChannel(channel);
+		while(!(adcValidMask & BIT(channel))){
+			//wait for the ISR to get to the new channel
 		}
+		adcStallCounts[channel & 0x07] += adcClock() - stallStart;
 	}
-	// grab latest registry values
-	cli(); // stop global interrupts
-	unsigned short temp_adch = adch;
-	unsigned short temp_adcl = adcl;
-	sei(); // set global interrupts
+	adcSample sample;
+	getADCSample(channel, &sample); // grab latest snapshot
+	return sample.value >> sample.bits; // back to 10 bits for old callers
+}
+
+/**
+ * @brief copies the latest sample of a channel without masking interrupts
+ * @details retries the copy if the ISR published a new sample mid-read
+ * @param channel the ADC channel to read
+ * @param sample where to put the copy
+ */
+void getADCSample(int channel, adcSample *sample){
+	adcRecord *record = &adcRecords[channel & 0x07];
+	unsigned char seq;
+	adcReads[channel & 0x07]++;
+	while(1){
+		seq = record->seq;
+		sample->value = record->sample.value;
+		sample->count = record->sample.count;
+		sample->stamp = record->sample.stamp;
+		// an unchanged, even seq means the ISR didn't touch the sample
+		if(seq == record->seq && !(seq & 0x01))
+			break;
+		adcReadRetries[channel & 0x07]++;
+	}
+}
 
-	// parse the 2 registers to get 1 10bit value
-	unsigned int adc_val;
-	adc_val = temp_adch & 0x3; // gets last 2 bits
-	adc_val = adc_val << 8; //move those 2 bits over 8 to make room
-	adc_val |= temp_adcl; // fill empty 8 bits with adcl bits
-	return adc_val;
+/**
+ * @brief gets how many times readers had to retry a sample copy
+ *
+ * @return number of retried reads since initADC
+ */
+unsigned long getADCReadRetries(){
+	unsigned long retries = 0;
+	unsigned char i;
+	for(i = 0; i < ADC_NUM_CHANNELS; i++)
+		retries += adcReadRetries[i];
+	return retries;
 }
 
 /**
@@ -130,6 +484,321 @@ unsigned short getADC(int channel){
  *
  */
 void changeADC(int channel){
-	ADMUX &= 0xF8; // zero out current mux channel 1111 1000
-	ADMUX |= channel; // set mux channel TODO make this more efficient
+	ADMUX = (ADMUX & 0xF8) | channel; // swap mux channel bits 1111 1000
+}
+
+/**
+ * @brief Replaces the list of channels the ADC ISR cycles through.
+ * @param channels array of channel numbers (0-7) to scan in order
+ * @param length number of channels in the array (1 to ADC_MAX_SCAN)
+ */
+void setADCScanList(const unsigned char *channels, unsigned char length){
+	unsigned char i;
+	if(length == 0 || length > ADC_MAX_SCAN)
+		return;
+	// hold off the ADC interrupt while the list changes, the pending
+	// conversion still knows its own channel through convertingChannel
+	unsigned char adie = ADCSRA & BIT(ADIE);
+	ADCSRA &= ~BIT(ADIE);
+	adcScanMask = 0;
+	for(i = 0; i < length; i++){
+		scanList[i] = channels[i] & 0x07;
+		adcScanMask |= BIT(scanList[i]);
+	}
+	scanLength = length;
+	if(scanIndex >= scanLength)
+		scanIndex = 0;
+	if(backgroundIndex >= scanLength)
+		backgroundIndex = 0;
+	backgroundMask &= adcScanMask;
+	ADCSRA |= adie;
+}
+
+/**
+ * @brief Adds one channel to the end of the scan list if it isn't there.
+ * @param channel the ADC channel to start scanning
+ */
+void addADCScanChannel(int channel){
+	channel &= 0x07;
+	if((adcScanMask & BIT(channel)) || scanLength >= ADC_MAX_SCAN)
+		return;
+	unsigned char adie = ADCSRA & BIT(ADIE);
+	ADCSRA &= ~BIT(ADIE);
+	scanList[scanLength] = channel;
+	scanLength++;
+	adcScanMask |= BIT(channel);
+	ADCSRA |= adie;
+}
+
+/**
+ * @brief checks if a channel is in the scan list and has a reading
+ * @param channel the ADC channel to check
+ *
+ * @return TRUE if getADC can return a real sample for the channel
+ */
+BOOL adcChannelReady(int channel){
+	return (adcScanMask & adcValidMask & BIT(channel)) != 0;
+}
+
+/**
+ * @brief sets how many extra bits a channel is oversampled to
+ * @details the ISR sums 4^bits back to back conversions of the channel and
+ * shifts the sum right by bits, giving a 10+bits wide result
+ * @param channel the ADC channel to configure
+ * @param bits 0 for plain 10 bit readings, up to ADC_MAX_OVERSAMPLE_BITS
+ */
+void setADCOversample(int channel, unsigned char bits){
+	channel &= 0x07;
+	if(bits > ADC_MAX_OVERSAMPLE_BITS)
+		bits = ADC_MAX_OVERSAMPLE_BITS;
+	unsigned char adie = ADCSRA & BIT(ADIE);
+	ADCSRA &= ~BIT(ADIE);
+	oversampleBits[channel] = bits;
+	// restart the burst, a half finished one would mix the two widths
+	accum[channel] = 0;
+	accumCount[channel] = 0;
+	ADCSRA |= adie;
+}
+
+/**
+ * @brief counts the conversions in one pass of some of the scan list
+ * @param background TRUE for the background channels, FALSE for the rest
+ *
+ * @return conversions, 4^bits for each channel
+ */
+unsigned int adcConversions(BOOL background){
+	unsigned int conversions = 0;
+	unsigned char i;
+	for(i = 0; i < scanLength; i++)
+		if(((backgroundMask & BIT(scanList[i])) != 0) == background)
+			conversions += 1 << (2 * oversampleBits[scanList[i]]);
+	return conversions;
+}
+
+/**
+ * @brief gets how many conversions one tick triggered sweep takes
+ * @details each channel costs 4^bits conversions, at ADC_CONVERSIONS_PER_SEC.
+ * Background channels aren't part of the sweep.
+ *
+ * @return conversions per sweep
+ */
+unsigned int getADCSweepConversions(){
+	return adcConversions(FALSE);
+}
+
+/**
+ * @brief gets how often a channel publishes a new sample
+ * @details background channels share what is left of each tick after the
+ * sweep, so theirs is an estimate
+ * @param channel the ADC channel to check
+ *
+ * @return samples per second, 0 if the channel isn't scanned
+ */
+unsigned int getADCSampleRate(int channel){
+	unsigned int tickRate = F_CLOCK / 1024 / (OCR0A + 1);
+	unsigned long sweep = (unsigned long)getADCSweepConversions() * tickRate;
+	long spare;
+	channel &= 0x07;
+	if(!(adcScanMask & BIT(channel)))
+		return 0;
+	if(adcTrigger != ADC_TIMER0_TRIGGER) // every channel, back to back
+		return ADC_CONVERSIONS_PER_SEC / (adcConversions(FALSE) + adcConversions(TRUE));
+
+	if(!(backgroundMask & BIT(channel))){
+		// once per Timer0 compare match, if the sweeps fit
+		if(sweep > ADC_CONVERSIONS_PER_SEC)
+			return ADC_CONVERSIONS_PER_SEC / getADCSweepConversions();
+		return tickRate;
+	}
+	// a conversion is 13 * 128 / 1024 Timer0 counts, and each tick keeps
+	// ADC_BACKGROUND_COUNTS of them clear for the sweep
+	spare = ADC_CONVERSIONS_PER_SEC - sweep
+			- (long)tickRate * ADC_BACKGROUND_COUNTS * 8 / 13;
+	if(spare <= 0)
+		return 0;
+	return spare / adcConversions(TRUE);
+}
+
+/**
+ * @brief moves a channel out of the tick triggered sweep, to be converted
+ * between sweeps instead, or back into it
+ * @details for channels that don't need to be in step with the control
+ * tick. Their samples come as often as the time between sweeps allows,
+ * which shortens the sweep and can be more often than once a tick. With
+ * ADC_FREE_RUN they are scanned with the rest.
+ * @param channel the ADC channel, added to the scan list if it isn't in it
+ * @param background TRUE to convert it between sweeps
+ */
+void setADCBackground(int channel, BOOL background){
+	unsigned char adie;
+	channel &= 0x07;
+	addADCScanChannel(channel);
+	adie = ADCSRA & BIT(ADIE);
+	ADCSRA &= ~BIT(ADIE);
+	if(background)
+		backgroundMask |= BIT(channel);
+	else
+		backgroundMask &= ~BIT(channel);
+	ADCSRA |= adie;
+}
+
+/**
+ * @brief picks what starts each sweep of the scan list
+ * @param trigger one of the adcTriggers
+ */
+void setADCTrigger(unsigned char trigger){
+	unsigned char adie = ADCSRA & BIT(ADIE);
+	ADCSRA &= ~BIT(ADIE);
+	adcTrigger = trigger;
+	if(trigger == ADC_TIMER0_TRIGGER){
+		// the running conversion finishes as if it were background, then the
+		// compare match starts the next sweep
+		sweepRunning = FALSE;
+		backgroundTick = timerCount;
+		ADCSRA |= BIT(ADATE);
+	}
+	else {
+		ADCSRA &= ~BIT(ADATE);
+		// kick the chain back off if it was idle waiting for the timer
+		if(!(ADCSRA & (BIT(ADSC) | BIT(ADIF))))
+			ADCSRA |= BIT(ADSC);
+	}
+	ADCSRA |= adie;
+}
+
+/**
+ * @brief gets what starts each sweep of the scan list
+ *
+ * @return one of the adcTriggers
+ */
+unsigned char getADCTrigger(){
+	return adcTrigger;
+}
+
+/**
+ * @brief checks if a full sweep finished since the last time this was asked
+ *
+ * @return TRUE once per completed sweep of the scan list
+ */
+BOOL adcSweepReady(){
+	unsigned long sweeps = getADCSweepCount();
+	if(sweeps == lastSweepSeen)
+		return FALSE;
+	lastSweepSeen = sweeps;
+	return TRUE;
+}
+
+/**
+ * @brief gets the number of completed sweeps of the scan list
+ *
+ * @return sweeps since initADC
+ */
+unsigned long getADCSweepCount(){
+	unsigned long sweeps;
+	// re-read until two copies match in case the ISR bumped it mid-read
+	do {
+		sweeps = sweepCount;
+	} while(sweeps != sweepCount);
+	return sweeps;
+}
+
+/**
+ * @brief timestamps a channel crossing a pair of thresholds
+ * @details the ISR checks every sample it publishes on the channel, so the
+ * stamps are as fine as the channel's sample rate rather than the control
+ * tick. The gap between the thresholds keeps noise from making extra edges.
+ * @param channel the ADC channel to watch
+ * @param high 10 bit reading the channel has to reach for a rising edge,
+ * 0 to stop watching the channel
+ * @param low 10 bit reading the channel has to drop below for a falling edge
+ */
+void setADCEdgeDetect(int channel, unsigned short high, unsigned short low){
+	channel &= 0x07;
+	unsigned char adie = ADCSRA & BIT(ADIE);
+	ADCSRA &= ~BIT(ADIE);
+	edgeHigh[channel] = high;
+	edgeLow[channel] = low;
+	edgeAbove &= ~BIT(channel); // a channel already up gives a rising edge
+	if(high)
+		edgeMask |= BIT(channel);
+	else
+		edgeMask &= ~BIT(channel);
+	ADCSRA |= adie;
+	if(high)
+		addADCScanChannel(channel);
+}
+
+/**
+ * @brief takes the oldest edge the ISR found off its queue
+ * @param edge where to put the edge
+ *
+ * @return FALSE if there are no edges waiting
+ */
+BOOL getADCEdge(adcEdge *edge){
+	if(edgeHead == edgeTail)
+		return FALSE;
+	// the ISR doesn't touch a queued edge until edgeHead moves past it
+	*edge = edgeQueue[edgeHead];
+	edgeHead = (edgeHead + 1) & (ADC_EDGE_QUEUE_SIZE - 1);
+	return TRUE;
+}
+
+/**
+ * @brief drops any edges waiting on the queue
+ */
+void clearADCEdges(){
+	edgeHead = edgeTail;
+}
+
+/**
+ * @brief gets the instrumentation counters for one channel
+ * @param channel the ADC channel to get counters for
+ * @param stats where to put the counters
+ */
+void getADCStats(int channel, adcStats *stats){
+	adcRecord *record = &adcRecords[channel & 0x07];
+	unsigned char seq;
+	unsigned long stamp;
+	// same retry scheme as getADCSample, without counting it as a read
+	do {
+		seq = record->seq;
+		stats->conversions = record->conversions;
+		stamp = record->sample.stamp;
+	} while(seq != record->seq || (seq & 0x01));
+
+	stats->reads = adcReads[channel & 0x07];
+	stats->retries = adcReadRetries[channel & 0x07];
+	stats->stallCounts = adcStallCounts[channel & 0x07];
+	stats->sampleAge = (adcValidMask & BIT(channel & 0x07)) ? timerCount - stamp : 0;
+}
+
+/**
+ * @brief zeroes the read, retry and stall counters of every channel
+ */
+void resetADCStats(){
+	unsigned char i;
+	for(i = 0; i < ADC_NUM_CHANNELS; i++){
+		adcReads[i] = 0;
+		adcReadRetries[i] = 0;
+		adcStallCounts[i] = 0;
+	}
+}
+
+/**
+ * @brief prints the counters of every scanned channel over the debug USART
+ */
+void printADCStats(){
+	adcStats stats;
+	unsigned char i;
+	printf("Chan,Conversions,Reads,Retries,Stall(us),Age(ticks),Rate(Hz)\n\r");
+	for(i = 0; i < ADC_NUM_CHANNELS; i++){
+		if(!(adcScanMask & BIT(i)))
+			continue;
+		getADCStats(i, &stats);
+		// each Timer0 count is 1024 clocks, about 55.6us
+		printf("%u,%lu,%lu,%lu,%lu,%lu,%u\n\r", i, stats.conversions,
+				stats.reads, stats.retries,
+				(unsigned long)(stats.stallCounts * (1024000000.0 / F_CLOCK)),
+				stats.sampleAge, getADCSampleRate(i));
+	}
 }
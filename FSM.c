@@ -17,138 +17,511 @@
 #include "include/arm.h"
 #include "RBELib/RBELib.h"
 #include "include/gripper.h"
+#include "include/ADC.h"
+#include "include/conveyor.h"
+#include <avr/pgmspace.h>
 #include "math.h"
 
+/**
+ * @var blockId
+ * id of the block being picked, the tracker's sequence number for it
+ *
+ * @var blockX
+ * x of the block being picked in mm
+ *
+ * @var grabTime
+ * getTimeSeconds time the block being picked gets to the arm
+ */
+unsigned int blockId;
+int blockX;
+float grabTime;
+
+/**
+ * @brief starts a pick cycle: conveyor on, gripper open, arm up high
+ */
+void enterInitialize(){
+	//reset servo positions
+	startConveyor();
+	openGripper();
+	//reset current averages
+	getAverageCurrent(resetCurrent,0);
+	//place arm in high waiting position, as fast as the joints go
+	movePosition(Center_X,Starting_Height,TRAJ_TRAPEZOID);
+}
+
+/**
+ * @brief goes straight on to waiting for a block
+ *
+ * @return the next state
+ */
+unsigned char runInitialize(){
+	return WaitForBlock;
+}
+
+/**
+ * @brief waits for a block on the belt
+ *
+ * @return the next state
+ */
+unsigned char runWaitForBlock(){
+	openGripper();
+	//check if a block is on the belt, if so, move arm to waiting
+	if(conveyorBlockSeen())
+		return CalcBlockX;
+	return WaitForBlock;
+}
+
+/**
+ * @brief moves the arm down to wait over the middle of the belt
+ */
+void enterCalcBlockX(){
+	setPosition(Center_X,Waiting_Height);
+}
+
+/**
+ * @brief waits for the tracker to find how far away the oldest block is
+ *
+ * @return the next state
+ */
+unsigned char runCalcBlockX(){
+	conveyorEstimate block;
+	if(!getConveyorEstimate(&block))
+		return WaitForBlock; // the tracker gave up on it
+	if(!block.located)
+		return CalcBlockX;
+	blockId = block.id; // so the x can't be paired with another block's time
+	blockX = block.x; //store block x position
+	return CalcBlockSpeed;
+}
+
+/**
+ * @brief moves the arm over the block
+ */
+void enterCalcBlockSpeed(){
+	setPosition(blockX,Waiting_Height); // adjust arm towards block
+}
+
+/**
+ * @brief waits until the 2nd sensor has seen the block for a speed and
+ * grab time, then checks the arm can make it
+ *
+ * @return the next state
+ */
+unsigned char runCalcBlockSpeed(){
+	conveyorEstimate block;
+	if(!getConveyorEstimate(&block))
+		return WaitForBlock;
+	if(block.id != blockId)
+		return CalcBlockX; // the tracker gave up on it, locate the next one
+	if(!block.fitted)
+		return CalcBlockSpeed;
+	grabTime = block.intercept; // time when block goes in front of arm
+	printf("Block %.1f mm/s, at arm %.2f s, confidence %.2f, %u on the belt\n\r",
+			block.velocity, block.intercept, block.confidence, conveyorBlockCount());
+	// the move over the block has to be done before the dip starts,
+	// if it can't be near enough go for the next one instead
+	float late = getArrivalTime() - (grabTime + Time_To_Move);
+	if(late > Max_Late){
+		printf("Skipping block, arm would be %.2f s late\n\r", late);
+		dropConveyorBlock();
+		printConveyorStats();
+		return WaitForBlock;
+	}
+	if(late > 0)
+		printf("Arm will be %.2f s late for the block\n\r", late);
+	return ExecuteGrabMotion;
+}
+
+/**
+ * @brief waits until it's time to dip onto the block
+ *
+ * @return the next state
+ */
+unsigned char runExecuteGrabMotion(){
+	conveyorEstimate block;
+	// the sensors losing the block refine the fit until we commit
+	if(getConveyorEstimate(&block)){
+		if(block.id != blockId)
+			return CalcBlockX; // it was dropped, start over on the next one
+		grabTime = block.intercept;
+	}
+	// if we are away from grabTime by the time it takes to move, begin!
+	if((getTimeSeconds() + Time_To_Move) >= grabTime)
+		return GrabBlock;
+	return ExecuteGrabMotion;
+}
+
+/**
+ * @brief dips straight down onto the block
+ */
+void enterGrabBlock(){
+	moveStraight(blockX,Grab_Height,Grab_Speed);
+}
+
+/**
+ * @brief waits until it's time to close the gripper
+ *
+ * @return the next state
+ */
+unsigned char runGrabBlock(){
+	conveyorEstimate block;
+	if(getConveyorEstimate(&block) && block.id == blockId)
+		grabTime = block.intercept;
+	// if we are away from the grab time by gripper grab time, start close!
+	if((getTimeSeconds() + Time_To_Grab) >= grabTime)
+		return WaitForGripper;
+	return GrabBlock;
+}
+
+/**
+ * @brief closes the gripper
+ */
+void enterWaitForGripper(){
+	closeGripper();
+}
+
+/**
+ * @brief waits until the gripper is done closing
+ *
+ * @return the next state
+ */
+unsigned char runWaitForGripper(){
+	if(getTimeSeconds() >= grabTime + Time_To_Close)
+		return MoveBlockUp;
+	return WaitForGripper;
+}
+
+/**
+ * @brief got it, the next block is the oldest now
+ */
+void exitWaitForGripper(){
+	conveyorEstimate block;
+	if(getConveyorEstimate(&block) && block.id == blockId)
+		dropConveyorBlock();
+}
+
+/**
+ * @brief moves the block upward away from conveyor
+ */
+void enterMoveBlockUp(){
+	moveStraight(Center_X + 50,Waiting_Height+150,Lift_Speed);
+}
+
+/**
+ * @brief goes straight on to weighing the block on the way up
+ *
+ * @return the next state
+ */
+unsigned char runMoveBlockUp(){
+	return CheckWeight;
+}
+
+/**
+ * @brief averages the joint 2 current during the lift, then picks where
+ * to drop the block
+ *
+ * @return the next state
+ */
+unsigned char runCheckWeight(){
+	getAverageCurrent(addCurrent,getCurrent(2));
+	//sample until reaching position
+	if(!doneMoving())
+		return CheckWeight;
+	//if a heavy block, drop close, else drop far
+	if(fabs(getAverageCurrent(retrieveAverageCurrent,2)) >= Heavy_Current_Threshold)
+		return GenerateTrajectoryDropClose;
+	return GenerateTrajectoryDropFar;
+}
+
+/**
+ * @brief moves the arm to a close drop position, as fast as the joints go
+ */
+void enterGenerateTrajectoryDropClose(){
+	movePosition(Drop_Close_X,Drop_Close_Y,TRAJ_TRAPEZOID);
+}
+
+/**
+ * @brief moves the arm to a far drop position, as fast as the joints go
+ */
+void enterGenerateTrajectoryDropFar(){
+	movePosition(Drop_Far_X,Drop_Far_Y,TRAJ_TRAPEZOID);
+}
+
+/**
+ * @brief goes straight on to waiting for the drop move
+ *
+ * @return the next state
+ */
+unsigned char runGenerateTrajectory(){
+	return ExecuteDropMotion;
+}
+
+/**
+ * @brief waits until the drop motion completes
+ *
+ * @return the next state
+ */
+unsigned char runExecuteDropMotion(){
+	if(doneMoving())
+		return DropBlock;
+	return ExecuteDropMotion;
+}
+
+/**
+ * @brief opens the gripper to drop the block
+ */
+void enterDropBlock(){
+	openGripper();
+}
+
+/**
+ * @brief goes back round for the next block
+ *
+ * @return the next state
+ */
+unsigned char runDropBlock(){
+	return Initialize;
+}
+
+/**
+ * @var fsmStates
+ * what each state does, indexed by FSMStates
+ */
+const fsmState fsmStates[FSM_NUM_STATES] PROGMEM = {
+	[Initialize] = {"Initialize", enterInitialize, runInitialize, 0},
+	[WaitForBlock] = {"WaitForBlock", 0, runWaitForBlock, 0},
+	[CalcBlockX] = {"CalcBlockX", enterCalcBlockX, runCalcBlockX, 0},
+	[CalcBlockSpeed] = {"CalcBlockSpeed", enterCalcBlockSpeed, runCalcBlockSpeed, 0},
+	[ExecuteGrabMotion] = {"ExecuteGrabMotion", 0, runExecuteGrabMotion, 0},
+	[GrabBlock] = {"GrabBlock", enterGrabBlock, runGrabBlock, 0},
+	[WaitForGripper] = {"WaitForGripper", enterWaitForGripper, runWaitForGripper, exitWaitForGripper},
+	[MoveBlockUp] = {"MoveBlockUp", enterMoveBlockUp, runMoveBlockUp, 0},
+	[CheckWeight] = {"CheckWeight", 0, runCheckWeight, 0},
+	[GenerateTrajectoryDropFar] = {"GenerateTrajectoryDropFar", enterGenerateTrajectoryDropFar, runGenerateTrajectory, 0},
+	[GenerateTrajectoryDropClose] = {"GenerateTrajectoryDropClose", enterGenerateTrajectoryDropClose, runGenerateTrajectory, 0},
+	[ExecuteDropMotion] = {"ExecuteDropMotion", 0, runExecuteDropMotion, 0},
+	[DropBlock] = {"DropBlock", enterDropBlock, runDropBlock, 0}
+};
+
+/**
+ * @var fsmCurrent
+ * the state the FSM is in
+ *
+ * @var fsmStarted
+ * FALSE until the first state has been entered
+ *
+ * @var fsmEnteredAt
+ * Timer0 counts when the current state was entered
+ *
+ * @var fsmCycleStart
+ * Timer0 counts when the current pick cycle started at Initialize
+ */
+unsigned char fsmCurrent = Initialize;
+BOOL fsmStarted;
+unsigned long fsmEnteredAt;
+unsigned long fsmCycleStart;
+
+/**
+ * @var fsmDwells
+ * how long each state lasts
+ *
+ * @var fsmCycleDwell
+ * how long a pick cycle lasts, Initialize to Initialize
+ *
+ * @var fsmTrace
+ * ring of the latest transitions, the next one goes at fsmTraceNext
+ *
+ * @var fsmTraceNext
+ * index in fsmTrace the next transition goes at
+ *
+ * @var fsmTraceCount
+ * transitions in fsmTrace, up to FSM_TRACE_SIZE
+ */
+fsmDwell fsmDwells[FSM_NUM_STATES];
+fsmDwell fsmCycleDwell;
+fsmTransition fsmTrace[FSM_TRACE_SIZE];
+unsigned char fsmTraceNext;
+unsigned char fsmTraceCount;
+
+/**
+ * @brief adds a stay to a dwell record
+ * @param dwell the record
+ * @param counts how long the stay was in Timer0 counts
+ */
+void addDwell(fsmDwell *dwell, unsigned long counts){
+	if(!dwell->visits || counts < dwell->minCounts)
+		dwell->minCounts = counts;
+	if(counts > dwell->maxCounts)
+		dwell->maxCounts = counts;
+	dwell->totalCounts += counts;
+	dwell->visits++;
+}
+
+/**
+ * @brief enters a state, stamping and tracing the transition
+ * @param from the state being left
+ * @param to the state to enter
+ * @param now Timer0 counts now
+ */
+void enterState(unsigned char from, unsigned char to, unsigned long now){
+	fsmTrace[fsmTraceNext].from = from;
+	fsmTrace[fsmTraceNext].to = to;
+	fsmTrace[fsmTraceNext].clock = now;
+	fsmTraceNext = (fsmTraceNext + 1) & (FSM_TRACE_SIZE - 1);
+	if(fsmTraceCount < FSM_TRACE_SIZE)
+		fsmTraceCount++;
+
+	if(to == Initialize){
+		if(fsmStarted)
+			addDwell(&fsmCycleDwell, now - fsmCycleStart);
+		fsmCycleStart = now;
+	}
+	fsmCurrent = to;
+	fsmEnteredAt = now;
+	void (*entry)() = (void (*)())pgm_read_word(&fsmStates[to].entry);
+	if(entry)
+		entry();
+}
+
 /**
  * @brief runs FSM for the final project
+ * @details runs the current state's handler from the state table, and on a
+ * change of state its exit handler and the next state's entry handler,
+ * timing and tracing the transition
  */
 void finiteStateMachine(){
-	static float blockStartTime = 0; // time block was first detected
-	static int blockX = 0; // storing block x coordinate
-	static float grabTime = 0; //time that block needs to be grabbed
-	//for case CalcBlockX
-	static int IRSampleMin = 999; // storing minumum distance detected by IR
-	static int IRSamplesIncreasing = 0; //for counting times the distances increase
-	int reading; // temporary holder for IR reading
-
-	static char state = Initialize; // storing the state of the FSM
-	switch(state){
-	case Initialize:
-		//reset servo positions
-		startConveyor();
-		openGripper();
-		//reset current averages
-		getAverageCurrent(resetCurrent,0);
-		//place arm in high waiting position
-		setPosition(Center_X,Starting_Height);
-		state = WaitForBlock;
-		break;
-
-	case WaitForBlock:
-		openGripper();
-		//check if block is sensed on first sensor, if so, move arm to waiting
-		if(IRDist(IR_FRONT_PIN) <= Distance_Threshold){
-			blockStartTime = getTimeSeconds(); //save the current time
-			setPosition(Center_X,Waiting_Height);
-			state = CalcBlockX;//move to next state
-		}
-		break;
-
-	case CalcBlockX:
-		//take the lowest reading of X values with some filtering
-		reading = calibratedIRVal(IRDist(IR_FRONT_PIN)); //calibrated distance
-		//not done sampling until values increase consecutively(reached min)
-		if(IRSamplesIncreasing < 40){
-			// if reading is new min, still decreasing in values
-			// note - make sure we don't get values outside of conveyor range
-			if((reading <= IRSampleMin) && (reading >= 85)){
-				IRSampleMin = reading; // set reading as new min
-				IRSamplesIncreasing = 0; // we are not increasing
-			}
-			//otherwise, we have started ascending from minumum
-			else
-				IRSamplesIncreasing++;
-		}
-		else{ //done sampling
-			blockX = IRSampleMin + X_IR_Offset + Fudged_X; //store block x position
-
-			setPosition(blockX,Waiting_Height); // adjust arm towards block
-			state = CalcBlockSpeed;
-			IRSamplesIncreasing = 0; //reset variables
-			IRSampleMin = 999;
-		}
-		break;
-	case CalcBlockSpeed:
-		// wait until 2nd sensor is toggled, calculate velocity and grab time
-		if(IRDist(IR_BACK_PIN)<= Distance_Threshold){
-			float deltaT = getTimeSeconds() - blockStartTime;
-			float velocity = (float) Distance_Between_IR/deltaT; //mm/sec
-			grabTime = Distance_IR_To_Arm/velocity + getTimeSeconds(); // time when block goes in front of arm
-			state = ExecuteGrabMotion;
-		}
-		break;
-	case ExecuteGrabMotion:
-		// if we are away from grabTime by the time it takes to move, begin!
-		if ((getTimeSeconds() + Time_To_Move) >= grabTime) {
-			setPosition(blockX,Grab_Height); // set arm position
-			state = GrabBlock;
-		}
-		break;
-	case GrabBlock:
-		// if we are away from the grab time by gripper grab time, start close!
-		if ((getTimeSeconds() + Time_To_Grab) >= grabTime) {
-			closeGripper();
-			state = WaitForGripper;
-		}
-		break;
-	case WaitForGripper:
-		// wait until the gripper is done closing
-		if(getTimeSeconds() >= grabTime + Time_To_Close) {
-			state = MoveBlockUp;
-		}
-		break;
-	case MoveBlockUp:
-		// move the block upward away from conveyor
-		setPosition(Center_X + 50,Waiting_Height+150);
-		state = CheckWeight;
-		break;
-	case CheckWeight:
-		//during the movment, average the currents seen on joint 2
-		getAverageCurrent(addCurrent,getCurrent(2));
-		//sample until reaching position
-		if(doneMoving()){
-			//if a heavy block, drop close, else drop far
-			if(fabs(getAverageCurrent(retrieveAverageCurrent,2)) >= Heavy_Current_Threshold){
-				state = GenerateTrajectoryDropClose;
-			}
-			else {
-				state = GenerateTrajectoryDropFar;
-			}
-		}
-		break;
-	case GenerateTrajectoryDropClose:
-		// move the arm to a close drop position
-		setPosition(Drop_Close_X,Drop_Close_Y);
-		state = ExecuteDropMotion;
-		break;
-	case GenerateTrajectoryDropFar:
-		// move arm to a far drop position
-		setPosition(Drop_Far_X,Drop_Far_Y);
-		state = ExecuteDropMotion;
-		break;
-	case ExecuteDropMotion:
-		//wait until the drop motion completes
-		if(doneMoving()){
-			state = DropBlock;
-		}
-		break;
-	case DropBlock:
-		// open the gripper to drop the block
-		openGripper();
-		state = Initialize;
-		break;
-	default:
+	serviceConveyorTracker(); // keep following every block, even while busy
+
+	if(!fsmStarted){
+		enterState(fsmCurrent, fsmCurrent, adcClock());
+		fsmStarted = TRUE;
+	}
+
+	unsigned char (*run)() = (unsigned char (*)())pgm_read_word(&fsmStates[fsmCurrent].run);
+	unsigned char next = run();
+	if(next == fsmCurrent)
+		return;
+	if(next >= FSM_NUM_STATES){
 		printf("Unknown FSM State!!\n\r");
-		break;
+		return;
+	}
+
+	unsigned long now = adcClock();
+	void (*leave)() = (void (*)())pgm_read_word(&fsmStates[fsmCurrent].exit);
+	if(leave)
+		leave();
+	addDwell(&fsmDwells[fsmCurrent], now - fsmEnteredAt);
+	enterState(fsmCurrent, next, now);
+}
+
+/**
+ * @brief converts Timer0 counts to milliseconds
+ * @param counts Timer0 counts (1024 clocks each)
+ *
+ * @return milliseconds
+ */
+float countsToMs(unsigned long counts){
+	return counts * 1000.0 / ((OCR0A + 1) * (float)controlTicksPerSec);
+}
+
+/**
+ * @brief prints one line of dwell times
+ * @param name what the times are for
+ * @param dwell the times
+ */
+void printDwell(const char *name, const fsmDwell *dwell){
+	if(!dwell->visits)
+		return;
+	printf("%s,%u,%.1f,%.1f,%.1f\n\r", name, dwell->visits, countsToMs(dwell->minCounts),
+			countsToMs(dwell->maxCounts), countsToMs(dwell->totalCounts) / dwell->visits);
+}
+
+/**
+ * @brief prints the shortest, longest and mean time spent in each state and
+ * in a whole pick cycle over the debug USART
+ */
+void printFSMStats(){
+	char name[FSM_NAME_LENGTH];
+	unsigned char i;
+	printf("State,Visits,Min(ms),Max(ms),Mean(ms)\n\r");
+	for(i = 0; i < FSM_NUM_STATES; i++){
+		strcpy_P(name, fsmStates[i].name);
+		printDwell(name, &fsmDwells[i]);
+	}
+	printDwell("PickCycle", &fsmCycleDwell);
+}
+
+/**
+ * @brief prints the latest transitions, oldest first, over the debug USART
+ */
+void printFSMTrace(){
+	char from[FSM_NAME_LENGTH];
+	char to[FSM_NAME_LENGTH];
+	unsigned char i;
+	unsigned char index = (fsmTraceNext - fsmTraceCount) & (FSM_TRACE_SIZE - 1);
+	unsigned long last = fsmTrace[index].clock;
+	printf("Time(ms),From,To,Dwell(ms)\n\r");
+	for(i = 0; i < fsmTraceCount; i++){
+		const fsmTransition *t = &fsmTrace[index];
+		strcpy_P(from, fsmStates[t->from].name);
+		strcpy_P(to, fsmStates[t->to].name);
+		// the time in the state being left, since the transition before
+		printf("%.1f,%s,%s,%.1f\n\r", countsToMs(t->clock), from, to, countsToMs(t->clock - last));
+		last = t->clock;
+		index = (index + 1) & (FSM_TRACE_SIZE - 1);
+	}
+}
+
+/**
+ * @brief zeroes the dwell times and empties the trace
+ */
+void resetFSMStats(){
+	unsigned char i;
+	for(i = 0; i < FSM_NUM_STATES; i++){
+		fsmDwells[i].visits = 0;
+		fsmDwells[i].minCounts = 0;
+		fsmDwells[i].maxCounts = 0;
+		fsmDwells[i].totalCounts = 0;
+	}
+	fsmCycleDwell.visits = 0;
+	fsmCycleDwell.minCounts = 0;
+	fsmCycleDwell.maxCounts = 0;
+	fsmCycleDwell.totalCounts = 0;
+	fsmTraceCount = 0;
+}
+
+/**
+ * @brief times one move and prints a line for it
+ * @param name what the move is
+ * @param x x to move to in mm
+ * @param y y to move to in mm
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ */
+void printMoveTime(char *name, float x, float y, unsigned char profile){
+	float start = getTimeSeconds();
+	float planned = movePosition(x, y, profile) / (float)controlTicksPerSec;
+	float taken;
+	do {
+		serviceArm();
+		taken = getTimeSeconds() - start;
+	} while(!doneMoving() && taken < Move_Time_Timeout);
+	printf("%s,%d,%.2f,%.2f\n\r", name, profile, planned, taken);
+}
+
+/**
+ * @brief times the drop and return moves with step setpoints, minimum jerk
+ * and trapezoidal trajectories, and prints planned and actual times
+ * @details runs serviceArm itself. Each time is from the move starting
+ * until doneMoving.
+ */
+void printMoveTimes(){
+	unsigned char profiles[] = {TRAJ_STEP, TRAJ_MIN_JERK, TRAJ_TRAPEZOID};
+	unsigned char i;
+	printf("Move,Profile,Planned(s),Taken(s)\n\r");
+	for(i = 0; i < sizeof(profiles); i++){
+		// start each run from the top of the lift, however it gets there
+		printMoveTime("Lift", Center_X + 50, Waiting_Height + 150, TRAJ_MIN_JERK);
+		printMoveTime("Drop far", Drop_Far_X, Drop_Far_Y, profiles[i]);
+		printMoveTime("Return", Center_X, Starting_Height, profiles[i]);
 	}
 }
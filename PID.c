@@ -2,13 +2,17 @@
  * @file PID.c
  *
  * @brief The source file for PID constants and calculations.
- * @details Sets the PID constants and calculate the PID value.
+ * @details Sets the PID constants and calculate the PID value. Each joint has
+ * a pidController that runs in integer math, setConst and calcPID map onto them.
  * @author Chris Bove
  * @date 2-3-16
  */
 
 #include "RBELib/RBELib.h"
 #include "include/definitions.h"
+#include "include/kinematics.h"
+#include "include/PID.h"
+#include "include/arm.h" // for controlTicksPerSec
 #include "math.h"
 
 /**
@@ -16,6 +20,15 @@
 */
 pidConst pidConsts;
 
+/**
+ * @var pidControllers
+ * controller for each joint, joint 1 first
+ */
+pidController pidControllers[PID_NUM_JOINTS] = {
+	{.staticTorque = JOINT_1_STATIC_TORQUE, .outputLimit = PID_OUTPUT_LIMIT},
+	{.staticTorque = JOINT_2_STATIC_TORQUE, .outputLimit = PID_OUTPUT_LIMIT}
+};
+
 /**
  * @brief Sets the Kp, Ki, and Kd values for 1 link.
  * @param link The link you want to set the values for (2 or 3).
@@ -29,145 +42,202 @@ void setConst(char link, float Kp, float Ki, float Kd){
 		pidConsts.Kp_H = Kp;
 		pidConsts.Ki_H = Ki;
 		pidConsts.Kd_H = Kd;
+		setPIDGains(&pidControllers[1], Kp, Ki, Kd); // link 3 moves on joint 2
 	}
 	else{
 		pidConsts.Kp_L = Kp;
 		pidConsts.Ki_L = Ki;
 		pidConsts.Kd_L = Kd;
+		setPIDGains(&pidControllers[0], Kp, Ki, Kd); // link 2 moves on joint 1
 	}
 
 }
 
 /**
- * @brief Calculate the PID value.
- * @param  link Which link to calculate the error for (Use 'U' and 'L').
- * @param setPoint The desired position of the link.
- * @param actPos The current position of the link.
- *
+ * @brief sets a controller's gains
+ * @details Ki and Kd are per PID_BASE_RATE tick and are scaled to the
+ * control loop rate, so a gain set keeps its meaning in seconds
+ * @param pid the controller to set
+ * @param Kp proportional gain in output per degree
+ * @param Ki integral gain in output per degree tick
+ * @param Kd derivative gain in output per degree per tick
  */
-signed int calcPID(char link, int setPoint, int actPos){
-	// ==== define static variables ====
-	// todo change some of these to constants.
-	// todo make these arrays or something nicer and more modular
-
-	// storing error summations
-	static int errorSumLink2 = 0;
-	static int errorSumLink3 = 0;
-	// storing the last errors
-	static int lastErrorLink2 = 0;
-	static int lastErrorLink3 = 0;
-	// holding a count of how many loops were completed to clear errorSums
-	static unsigned int loopCountLink2 = 0;
-	static unsigned int loopCountLink3 = 0;
-	// store the last setpoint to see when updates occur and reset vars
-	static int lastSetPointLink2 = 0;
-	static int lastSetPointLink3 = 0;
-	// constants for static torque for links
-	static const int link2StaticTorque = 150;
-	static const int link3StaticTorque = 200;
-	// constants for gravity and link masses (arbitrary values)
-	static const int gravity = 10;
-	static const int link2Mass = 20;
-	static const int link3Mass = 5;
-	// ==== END declarations ====
-
-	int currentError = setPoint - actPos; // calculate the current error
-
-	signed int output;
-	// if we are not within +-2, compute new output
-	// todo make this 2 value a constant defined somewhere
-	if(!betweenTwoVals(currentError,-2,2)){
-		// if on link 2, compute new output for that link
-		// todo this is gross. Make this use an array or something so it isn't repeated
-		if (link == 2) {
-			// if the setpoint changed, reset variables and continue
-			if (lastSetPointLink2 != setPoint) {
-				errorSumLink2 = 0;
-				loopCountLink2 = 0;
-				lastErrorLink2 = 0;
-				lastSetPointLink2 = setPoint;
-			}
-
-			// main output calculation: Kp, Ki, Kd, g, torqueConst
-			output = pidConsts.Kp_L * (currentError)
-					+ pidConsts.Ki_L * (errorSumLink2)
-					+ pidConsts.Kd_L * (currentError - lastErrorLink2)
-					// feed forward gravity compensation
-					+ (cos(actPos * RADS_PER_DEGREE) * gravity * link2Mass);
-			// add static torque based on direction we want to go in
-			if (currentError < 0) {
-				output -= link2StaticTorque;
-			} else {
-				output += link2StaticTorque;
-			}
-
-			lastErrorLink2 = currentError; // update last error
-			// if number of runs is over 5000, reset the sum.
-			// todo make this not a magic number
-			if (loopCountLink2 > 5000) {
-				errorSumLink2 = 0;
-			} else {
-				// otherwise, add to the summation
-				errorSumLink2 += currentError;
-			}
+void setPIDGains(pidController *pid, float Kp, float Ki, float Kd){
+	// per degree to Q12 per tenth of a degree, rounded
+	const float scale = (float)(1L << PID_GAIN_SHIFT) / TENTHS_PER_DEGREE;
+	// faster ticks sum more errors and see smaller changes per tick
+	const float ticks = (float)controlTicksPerSec / PID_BASE_RATE;
+	pid->kp = Kp * scale + 0.5;
+	pid->ki = Ki * scale / ticks + 0.5;
+	pid->kd = Kd * scale * ticks + 0.5;
+}
 
-			loopCountLink2++; // increment the loop counter
+/**
+ * @brief sets a controller's trajectory feedforward gains
+ * @param pid the controller to set
+ * @param Kv output per degree per second of desired velocity
+ * @param Ka output per degree per second^2 of desired acceleration
+ */
+void setPIDFeedforward(pidController *pid, float Kv, float Ka){
+	// same scaling as the PID gains
+	const float scale = (float)(1L << PID_GAIN_SHIFT) / TENTHS_PER_DEGREE;
+	pid->kv = Kv * scale + 0.5;
+	pid->ka = Ka * scale + 0.5;
+}
 
+/**
+ * @brief clears a controller's error sum
+ * @param pid the controller to reset
+ */
+void resetPIDController(pidController *pid){
+	pid->errorSum = 0;
+}
 
-		} else { // link 3
-			// if the setpoint changed, reset variables and continue
-			if (lastSetPointLink3 != setPoint) {
-				errorSumLink3 = 0;
-				loopCountLink3 = 0;
-				lastErrorLink3 = 0;
-				lastSetPointLink3 = setPoint;
-			}
+/**
+ * @brief runs one update of a controller
+ * @details the derivative acts on the filtered measured rate so setpoint
+ * steps don't kick it, and the integrator stops while the output is
+ * saturated in the direction of the error. While the target is moving the
+ * deadband is ignored and setpoint changes don't reset the integrator.
+ * @param pid the controller to update
+ * @param target desired angle, velocity and acceleration
+ * @param actPos measured angle in tenths of a degree
+ * @param feedforward output added on top of the PID and trajectory terms
+ *
+ * @return output for driveLink, within the controller's limit
+ */
+int updatePIDController(pidController *pid, const jointTarget *target, int actPos, int feedforward){
+	int currentError = target->position - actPos; // calculate the current error
+	BOOL holding = (target->velocity == 0 && target->acceleration == 0);
+
+	// low pass the measured rate, the pots and encoders step a count at a time
+	if(!pid->started){
+		pid->lastPos = actPos;
+		pid->started = TRUE;
+	}
+	long rawRate = (long)(actPos - pid->lastPos) << PID_DERIVATIVE_FRACTION;
+	pid->rate += (rawRate - pid->rate) >> PID_DERIVATIVE_SHIFT;
+	pid->lastPos = actPos;
+
+	// we're basically there, so just stop doing whatever you are.
+	if(holding && betweenTwoVals(currentError, -PID_DEADBAND, PID_DEADBAND)){
+		resetPIDController(pid);
+		pid->lastSetPoint = 0;
+		pid->output = 0;
+		return 0;
+	}
 
-			// main output calculation: Kp, Ki, Kd, g, torqueConst
-			output = pidConsts.Kp_H * (currentError)
-					+ pidConsts.Ki_H * (errorSumLink3)
-					+ pidConsts.Kd_H * (currentError - lastErrorLink3)
-					// feed forward gravity compensation based on angle with horizontal
-					+ (cos((actPos-(90-lastJoint1Angle))*RADS_PER_DEGREE)*gravity*link3Mass);
+	// if the setpoint jumped, reset variables and continue
+	if(holding && pid->lastSetPoint != target->position)
+		resetPIDController(pid);
+	pid->lastSetPoint = target->position;
+
+	// main output calculation: Kp, Ki, Kd, then the trajectory feedforward
+	long output = (pid->kp * currentError
+			+ pid->ki * pid->errorSum
+			- ((pid->kd * pid->rate) >> PID_DERIVATIVE_FRACTION)
+			+ pid->kv * target->velocity
+			+ pid->ka * target->acceleration) >> PID_GAIN_SHIFT;
+	output += feedforward;
+	// add static torque based on direction we want to go in
+	if(currentError < 0)
+		output -= pid->staticTorque;
+	else
+		output += pid->staticTorque;
+
+	// saturate, and only integrate if that won't push further into the limit
+	BOOL saturated = TRUE;
+	if(output > pid->outputLimit)
+		output = pid->outputLimit;
+	else if(output < -pid->outputLimit)
+		output = -pid->outputLimit;
+	else
+		saturated = FALSE;
+	if(!saturated || (output > 0) != (currentError > 0))
+		pid->errorSum += currentError;
+
+	pid->output = output;
+	return output;
+}
 
-			// add static torque based on direction we want to go in
-			if(currentError < 0) {
-				output -= link3StaticTorque;
-			}
-			else {
-				output += link3StaticTorque;
-			}
+/**
+ * @brief gets the output that holds a joint up against gravity
+ * @details each term is a link's gravity output at horizontal times the cos
+ * of its angle with horizontal, looked up in the kinematics sine table
+ * @param joint 1 or 2
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ *
+ * @return gravity feedforward output
+ */
+int gravityFeedforward(int joint, int theta1, int theta2){
+	if(joint == 1) // link 2 angle with horizontal is joint 1
+		return (LINK_2_GRAVITY * cosTenths(theta1) + (1L << 14)) >> 15;
+	else // link 3 angle with horizontal, same as the kinematics
+		return (LINK_3_GRAVITY * cosTenths(theta1 + theta2 - 900) + (1L << 14)) >> 15;
+}
 
-			lastErrorLink3 = currentError; // update last error
+/**
+ * @brief floating point gravity feedforward, what the table replaced
+ * @param joint 1 or 2
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ *
+ * @return gravity feedforward output
+ */
+int gravityFeedforwardFloat(int joint, int theta1, int theta2){
+	if(joint == 1)
+		return cos(theta1 * RADS_PER_DEGREE / TENTHS_PER_DEGREE) * LINK_2_GRAVITY;
+	else
+		return cos((theta1 + theta2 - 900) * RADS_PER_DEGREE / TENTHS_PER_DEGREE) * LINK_3_GRAVITY;
+}
 
-			// if number of runs is over 5000, reset the sum.
-			// todo make this not a magic number
-			if (loopCountLink3 > 5000) {
-				errorSumLink3 = 0;
-			} else {
-				errorSumLink3 += currentError;
+/**
+ * @brief sweeps the joint ranges and prints the cycles each gravity
+ * feedforward takes and the worst difference between them
+ */
+void printGravityCycles(){
+	unsigned long tableCycles = 0;
+	unsigned long floatCycles = 0;
+	unsigned int samples = 0;
+	int maxError = 0;
+	int theta1, theta2;
+	int joint;
+
+	// every 5 degrees over the joint ranges the arm actually uses
+	for(theta1 = 0; theta1 <= 1800; theta1 += 50){
+		for(theta2 = -900; theta2 <= 900; theta2 += 50){
+			for(joint = 1; joint <= PID_NUM_JOINTS; joint++){
+				startCycleCount();
+				int table = gravityFeedforward(joint, theta1, theta2);
+				tableCycles += readCycleCount();
+				startCycleCount();
+				int exact = gravityFeedforwardFloat(joint, theta1, theta2);
+				floatCycles += readCycleCount();
+
+				if(abs(table - exact) > maxError)
+					maxError = abs(table - exact);
+				samples++;
 			}
-
-			loopCountLink3++; // increment the loop counter
-		}
-	} else {
-		// we're basically there, so just stop doing whatever you are.
-		//zero variables
-		if(link == 2){
-			errorSumLink2 = 0;
-			loopCountLink2 = 0;
-			lastErrorLink2 = 0;
-			lastSetPointLink2 = 0;
 		}
-		else {
-			errorSumLink3 = 0;
-			loopCountLink3 = 0;
-			lastErrorLink3 = 0;
-			lastSetPointLink3 = 0;
-		}
-		output = 0; // set output to 0
-
 	}
+	printf("Gravity points,Max difference,Table cycles,Float cycles\n\r");
+	printf("%u,%d,%lu,%lu\n\r", samples, maxError, tableCycles / samples, floatCycles / samples);
+}
 
-	return output;
+/**
+ * @brief Calculate the PID value.
+ * @param  link Which link to calculate the error for (2 or 3).
+ * @param setPoint The desired position of the link.
+ * @param actPos The current position of the link.
+ *
+ * @return output for driveLink
+ */
+signed int calcPID(char link, int setPoint, int actPos){
+	// link 3 needs joint 1 for its angle with horizontal
+	int joint1 = (link == 3) ? lastJoint1Angle * TENTHS_PER_DEGREE : actPos * TENTHS_PER_DEGREE;
+	int joint = (link == 3) ? 2 : 1;
+	jointTarget target = {setPoint * TENTHS_PER_DEGREE, 0, 0};
+	return updatePIDController(&pidControllers[joint - 1], &target, actPos * TENTHS_PER_DEGREE,
+			gravityFeedforward(joint, joint1, actPos * TENTHS_PER_DEGREE));
 }
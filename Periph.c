@@ -10,6 +10,7 @@
 
 #include "RBELib/RBELib.h"
 #include "include/encoder.h"
+#include "include/ADC.h"
 
 
 /**
@@ -82,10 +83,14 @@ signed int getAccel(int axis){
  */
 int IRDist(int chan){
 	int IRRange = -1;
-	unsigned short sensorVal = getADC(chan);
+	adcSample sample;
+	if(!adcChannelReady(chan))
+		getADC(chan); // starts scanning the channel and waits for a reading
+	getADCSample(chan, &sample);
 	// sensor values above 3 are valid for linearization
-	if (sensorVal > 3){
-		IRRange = (67870 / (sensorVal - 3)) - 4; // do linearization equation
+	if (sample.value > (3 << sample.bits)){
+		// do linearization equation, scaled for any oversampled bits
+		IRRange = ((67870L << sample.bits) / (sample.value - (3 << sample.bits))) - 4;
 	}
 
 	return IRRange;
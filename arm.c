@@ -11,20 +11,16 @@
 #include "include/arm.h"
 #include "RBELib/RBELib.h"
 #include "include/definitions.h"
+#include "include/ADC.h"
+#include "include/kinematics.h"
+#include "include/calibration.h"
+#include "include/jointState.h"
+#include "include/PID.h"
+#include "include/autotune.h"
+#include "include/trajectory.h"
+#include "include/recorder.h"
 #include "math.h"
 
-/**
- * @var degreesPerJoint1Val
- * for storing the degrees per adc value for joint 1
- *
- * @var degreesPerJoint2Val
- * for storing the degrees per adc value for joint 2
- *
- * @todo change these to constants
- */
-float degreesPerJoint1Val;
-float degreesPerJoint2Val;
-
 /**
  * @var x_coord
  * for storing the current x coordinate of the arm
@@ -38,13 +34,14 @@ float x_coord;
 float y_coord;
 
 /**
- * @var L2L2
- * constant for optimizing Link 2 Length ^2
- * @var L3L3
- * constant for optimizing Link 3 Length ^2
+ * @var x_pos
+ * x coordinate of the arm from the fixed point FK, in tenths of a mm
+ *
+ * @var y_pos
+ * y coordinate of the arm from the fixed point FK, in tenths of a mm
  */
-float L2L2;
-float L3L3;
+int x_pos;
+int y_pos;
 
 /**
  * @var lowerAngle
@@ -58,25 +55,109 @@ float L3L3;
 int lowerAngle;
 int upperAngle;
 
+/**
+ * @var lowerAngleTenths
+ * lowerAngle in tenths of a degree, what gotoXY steps through the Jacobian
+ *
+ * @var upperAngleTenths
+ * upperAngle in tenths of a degree, what gotoXY steps through the Jacobian
+ */
+int lowerAngleTenths;
+int upperAngleTenths;
+
+/**
+ * @var armTrajectory
+ * minimum jerk move serviceArm follows when there is no line to track
+ */
+jointTrajectory armTrajectory;
+
+/**
+ * @var motionQueue
+ * ring buffer of joint moves for serviceArm to work through
+ *
+ * @var motionQueueHead
+ * index of the next segment to start
+ *
+ * @var motionQueueTail
+ * index the next queued segment goes in
+ *
+ * @var motionQueueRunning
+ * TRUE while the move under way came from the queue
+ *
+ * @var motionQueueEnding
+ * TRUE if the move under way is the last of its sequence
+ *
+ * @var motionQueueUnderruns
+ * times the motion queue ran dry before the end of a sequence
+ */
+motionSegment motionQueue[MOTION_QUEUE_SIZE];
+unsigned char motionQueueHead;
+unsigned char motionQueueTail;
+BOOL motionQueueRunning;
+BOOL motionQueueEnding;
+unsigned int motionQueueUnderruns;
+
+/**
+ * @var lineMoving
+ * TRUE while serviceArm is tracking a straight line set by moveStraight
+ *
+ * @var lineStartX
+ * x the line starts at in tenths of a mm
+ * @var lineStartY
+ * y the line starts at in tenths of a mm
+ * @var lineEndX
+ * x the line ends at in tenths of a mm
+ * @var lineEndY
+ * y the line ends at in tenths of a mm
+ * @var lineLength
+ * length of the line in tenths of a mm
+ * @var lineSpeed
+ * speed along the line in mm/s
+ * @var lineProgress
+ * distance covered along the line, in tenths of a mm times controlTicksPerSec
+ */
+BOOL lineMoving;
+int lineStartX;
+int lineStartY;
+int lineEndX;
+int lineEndY;
+int lineLength;
+int lineSpeed;
+long lineProgress;
+
 /**
  * @var servicePID
  * flag - TRUE if PID controller needs to be serviced, FALSE otherwise
  *
  * @var timerCount
- * for keeping time. increments in 0.01 seconds
+ * for keeping time. increments every control tick
+ *
+ * @var controlTicksPerSec
+ * rate serviceArm runs the control loop at (Timer0 compare matches per second)
+ *
+ * @var controlOverruns
+ * ticks that came before serviceArm finished the one before them
  *
+ * @var controlMaxCounts
+ * most Timer0 counts (1024 clocks each) a tick has taken to service
  */
 volatile BOOL servicePID;
 volatile unsigned long timerCount;
+unsigned int controlTicksPerSec = CONTROL_DEFAULT_RATE;
+volatile unsigned int controlOverruns;
+unsigned char controlMaxCounts;
 
 /**
- * @brief Timer ISR that runs at 100Hz
- * @details set flags for servicing at fixed intervals.
+ * @brief Timer ISR that runs at controlTicksPerSec
+ * @details set flags for servicing at fixed intervals. If the last tick's
+ * flag is still set it was never finished, so count an overrun.
  *
  * @param TIMER0_COMPA_vect Interrupt vector for timer0 vector on AVR
  *
  */
 ISR(TIMER0_COMPA_vect) {
+	if(servicePID)
+		controlOverruns++; // last tick hasn't been serviced yet
 	servicePID = TRUE; // time to service PID!
 	timerCount++; // increment our counter
 }
@@ -85,25 +166,77 @@ ISR(TIMER0_COMPA_vect) {
  * @brief initialize the arm variables
  */
 void initArm() {
-	// calculate conversions from adc values to degrees for each joint
-	degreesPerJoint1Val = 90.0/(JOINT_1_VAL_AT_90 - JOINT_1_VAL_AT_0);
-	degreesPerJoint2Val = 90.0/(JOINT_2_VAL_AT_90 - JOINT_2_VAL_AT_0);
-
-	//calculate some squares up front
-	L2L2 = pow(LINK_2_Length,2);
-	L3L3 = pow(LINK_3_Length,2);
+	// use the EEPROM pot calibration if there is one
+	loadJointCalibration();
 
 	// intialize devices and set constants for PID controllers
 	initADC(ADC3D); // init ADC
+	setADCOversample(ADC0D, CURRENT_OVERSAMPLE_BITS); // smooth current sense
+	setADCOversample(ADC1D, CURRENT_OVERSAMPLE_BITS);
+	// only the pots need to be in phase with the PID, the currents are
+	// converted between sweeps so the sweep fits even a 1 kHz tick
+	setADCBackground(ADC0D, TRUE);
+	setADCBackground(ADC1D, TRUE);
 	stopMotors();
 	setConst(2,20,0.1,4); // joint 2 - Kp, Ki, Kd
 	setConst(3,20,0.1,4); // joint 3 - Kp, Ki, Kd
+	loadTunedGains(); // replace them with auto-tuned ones if there are any
 	setupTimer();
+	setADCTrigger(ADC_TIMER0_TRIGGER); // sample once per tick, in phase with PID
+	initJointState(); // joint angles from a fresh sweep of the pots
 	setJointAngles(0,90); // set desired joint angles to 0
 }
 
 /**
- * @brief sets a 100Hz timer up on Timer 0
+ * @brief gives the user a moment to ask for joint calibration ('c'),
+ * encoder calibration ('e') or PID auto-tuning ('t') over the debug USART
+ * @param ticks how many control ticks to wait
+ */
+void offerArmSetup(unsigned int ticks){
+	printf("Send c to calibrate the joints (%s), e to measure the encoders (%s) or t to tune the PIDs\n\r",
+			jointCalibrationLoaded() ? "using saved calibration" : "no calibration saved",
+			getJointFeedback(1) == JOINT_FEEDBACK_ENCODER ? "joints on encoders" : "joints on pots");
+	unsigned long start = timerCount;
+	while(timerCount - start < ticks){
+		if(UCSR1A & BIT(RXC1)){
+			char c = getCharDebug();
+			if(c == 'c')
+				calibrateJoints();
+			else if(c == 'e')
+				calibrateEncoders();
+			else if(c == 't')
+				autotuneJoints();
+			else
+				continue;
+			return;
+		}
+	}
+}
+
+/**
+ * @brief gets the Timer 0 compare value for a control loop rate
+ * @param hz 100, 250, 500 or 1000
+ *
+ * @return OCR0A value, 0 if the rate isn't supported
+ */
+unsigned char controlRateCompare(unsigned int hz){
+	// 18kHz after the prescaler divides evenly by each of these
+	switch(hz){
+	case 100:
+		return 179;
+	case 250:
+		return 71;
+	case 500:
+		return 35;
+	case 1000:
+		return 17;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief sets the control loop timer up on Timer 0 at controlTicksPerSec
  */
 void setupTimer() {
 	// setup registers for the timer
@@ -111,24 +244,238 @@ void setupTimer() {
 	TCCR0A |= BIT(COM0A1); // Configure timer 1 for CTC mode
 
 	TCCR0B |= BIT(CS02) | BIT(CS00); // prescale by 1024 = 18kHz
-	OCR0A = 179; // divide by 180 -1  to get 100 Hz count
+	OCR0A = controlRateCompare(controlTicksPerSec); // divide by OCR0A + 1 to get the tick
 
 	timerCount = 0; // initialize timercount
+	controlOverruns = 0;
+	controlMaxCounts = 0;
 	TIMSK0 |= (1 << OCIE0A); // Enable CTC interrupt
 	sei(); // Enable global interrupts
 }
 
+/**
+ * @brief changes the control loop rate
+ * @details reloads the PID gains so Ki and Kd keep their meaning per second,
+ * and rescales timerCount so getTimeSeconds doesn't jump. With tick
+ * triggered sampling the sweep has to fit in one tick, or every tick would
+ * wait for the sweep and the loop would run slower. initArm leaves only
+ * the two pots in the sweep, 2 conversions, so every rate fits.
+ * @param hz 100, 250, 500 or 1000
+ *
+ * @return TRUE if the rate is supported and was set, FALSE if not or if
+ * the sweep doesn't fit
+ */
+BOOL setControlRate(unsigned int hz){
+	unsigned char compare = controlRateCompare(hz);
+	if(!compare)
+		return FALSE;
+	if(getADCTrigger() == ADC_TIMER0_TRIGGER
+			&& (unsigned long)getADCSweepConversions() * hz > ADC_CONVERSIONS_PER_SEC)
+		return FALSE; // the tick would wait on the sweep every time
+
+	cli(); // the ISR can't tick while the count and compare are changed
+	// whole seconds first so the count can't overflow
+	timerCount = timerCount / controlTicksPerSec * hz
+			+ timerCount % controlTicksPerSec * hz / controlTicksPerSec;
+	controlTicksPerSec = hz;
+	TCNT0 = 0;
+	OCR0A = compare;
+	servicePID = FALSE;
+	sei();
+
+	// setConst takes Ki and Kd per tick at PID_BASE_RATE, so set them again
+	setConst(2, pidConsts.Kp_L, pidConsts.Ki_L, pidConsts.Kd_L);
+	setConst(3, pidConsts.Kp_H, pidConsts.Ki_H, pidConsts.Kd_H);
+	controlOverruns = 0;
+	controlMaxCounts = 0;
+	return TRUE;
+}
+
+/**
+ * @brief prints the overruns and the longest tick since the last call, then
+ * clears them, and how the motion queue is doing
+ */
+void printControlStats(){
+	unsigned int overruns = controlOverruns;
+	controlOverruns = 0;
+	printf("Rate %u Hz, overruns %u, longest tick %u of %u counts\n\r",
+			controlTicksPerSec, overruns, controlMaxCounts, OCR0A + 1);
+	printf("Motion queue %u deep, %u underruns\n\r", motionQueueDepth(), motionQueueUnderruns);
+	controlMaxCounts = 0;
+}
+
 /**
  * @brief runs functions critical to arm operation. Call as often as possible.
  */
 void serviceArm(){
-	// if servicePID flag has been set (i.e. runs at 100Hz)
+	// if servicePID flag has been set (i.e. runs at controlTicksPerSec)
 	if(servicePID){
-		gotoAngles(lowerAngle, upperAngle); // run PID loop called in gotoAngles
+		// with tick triggered sampling, wait until this tick's set is in
+		if(getADCTrigger() == ADC_TIMER0_TRIGGER && !adcSweepReady())
+			return;
+		unsigned long tick = timerCount;
+		updateJointState(); // encoder angles for this tick
+		serviceRecorder(); // sample the joints if recording
+		serviceMotionQueue(); // start the next queued move if it's time
+		if(lineMoving)
+			serviceLine(); // step along the line, runs the PID loop too
+		else if(playingBack())
+			servicePlayback(); // next setpoint of the recording
+		else
+			serviceTrajectory(); // next setpoint of the move, or hold at its end
+		calcXYFixed(); // keep the cartesian position up to date every tick
 
+		// done with this tick. If the next one already came the ISR counted
+		// the overrun, so leave the flag set and service it straight away
+		servicePID = FALSE;
+		unsigned char counts = TCNT0; // counts since the tick started
+		if(tick != timerCount)
+			servicePID = TRUE;
+		else if(counts > controlMaxCounts)
+			controlMaxCounts = counts;
 	}
 }
 
+/**
+ * @brief moves the point along the line set by moveStraight one tick and
+ * drives the arm toward it
+ */
+void serviceLine(){
+	int x = lineEndX;
+	int y = lineEndY;
+	// where on the line we should be this tick
+	if(lineProgress < (long)lineLength * controlTicksPerSec){
+		lineProgress += lineSpeed * TENTHS_PER_MM;
+		long distance = lineProgress / controlTicksPerSec;
+		if(distance < lineLength){
+			x = lineStartX + (long)(lineEndX - lineStartX) * distance / lineLength;
+			y = lineStartY + (long)(lineEndY - lineStartY) * distance / lineLength;
+		}
+	}
+	gotoXY(x, y); // Jacobian step of the setpoint, then PID
+	lowerAngle = tenthsToDegrees(lowerAngleTenths);
+	upperAngle = tenthsToDegrees(upperAngleTenths);
+}
+
+/**
+ * @brief starts the next queued segment once the move before it is done or
+ * within its blend
+ */
+void serviceMotionQueue(){
+	if(motionQueueHead == motionQueueTail){
+		// the last queued move finished with nothing after it, which is only
+		// an underrun if more was meant to follow
+		if(motionQueueRunning && !armTrajectory.active){
+			motionQueueRunning = FALSE;
+			if(!motionQueueEnding)
+				motionQueueUnderruns++;
+		}
+		return;
+	}
+
+	motionSegment *next = &motionQueue[motionQueueHead];
+	if(lineMoving){
+		// wait for the line to run out
+		if(lineProgress < (long)lineLength * controlTicksPerSec)
+			return;
+	}
+	else if(armTrajectory.active){
+		// blend: start early once this tick's setpoint is close to the end
+		if(abs(armTrajectory.end[0] - lowerAngleTenths) > next->blend
+				|| abs(armTrajectory.end[1] - upperAngleTenths) > next->blend)
+			return;
+	}
+	moveJoints(next->lower, next->upper, next->profile);
+	motionQueueEnding = next->last;
+	motionQueueHead = (motionQueueHead + 1) & (MOTION_QUEUE_SIZE - 1);
+	motionQueueRunning = TRUE;
+}
+
+/**
+ * @brief adds a joint move to the end of the motion queue
+ * @param lowerTenths joint 1 angle to end at in tenths of a degree
+ * @param upperTenths joint 2 angle to end at in tenths of a degree
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ * @param blend how close in tenths of a degree the move before has to get
+ * to its end before this one starts, 0 to wait for it to finish
+ *
+ * @return FALSE if the queue is full
+ */
+BOOL queueJointMove(int lowerTenths, int upperTenths, unsigned char profile, int blend){
+	unsigned char tail = (motionQueueTail + 1) & (MOTION_QUEUE_SIZE - 1);
+	if(tail == motionQueueHead)
+		return FALSE; // one slot stays empty so full and empty look different
+	motionSegment *segment = &motionQueue[motionQueueTail];
+	segment->lower = lowerTenths;
+	segment->upper = upperTenths;
+	segment->profile = profile;
+	segment->blend = blend;
+	segment->last = FALSE;
+	motionQueueTail = tail; // only now can serviceMotionQueue see it
+	return TRUE;
+}
+
+/**
+ * @brief adds a move to an x, y position to the end of the motion queue
+ * @details the IK is solved now, so the control tick doesn't have to
+ * @param x desired x position in mm
+ * @param y desired y position in mm
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ * @param blend how close in tenths of a degree the move before has to get
+ * to its end before this one starts, 0 to wait for it to finish
+ *
+ * @return FALSE if the queue is full or the point is out of reach
+ */
+BOOL queuePosition(float x, float y, unsigned char profile, int blend){
+	int theta1, theta2;
+	int xTenths = x * TENTHS_PER_MM;
+	int yTenths = y * TENTHS_PER_MM;
+	if(!inverseKinematicsGrid(xTenths, yTenths, &theta1, &theta2)
+			&& !inverseKinematics(xTenths, yTenths, &theta1, &theta2))
+		return FALSE;
+	return queueJointMove(theta1, theta2, profile, blend);
+}
+
+/**
+ * @brief marks the last queued segment as the end of its sequence, so the
+ * queue running dry after it isn't counted as an underrun
+ */
+void endMotionSequence(){
+	if(motionQueueDepth())
+		motionQueue[(motionQueueTail - 1) & (MOTION_QUEUE_SIZE - 1)].last = TRUE;
+	else
+		motionQueueEnding = TRUE; // the last one is already under way
+}
+
+/**
+ * @brief empties the motion queue, the move under way carries on
+ */
+void clearMotionQueue(){
+	motionQueueHead = motionQueueTail;
+	motionQueueRunning = FALSE;
+}
+
+/**
+ * @brief gets how many segments are waiting in the motion queue
+ *
+ * @return number of queued segments, not counting the one under way
+ */
+unsigned char motionQueueDepth(){
+	return (motionQueueTail - motionQueueHead) & (MOTION_QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief drives the arm to this tick's setpoints of the joint trajectory
+ * @details once the move is over it holds the end angles
+ */
+void serviceTrajectory(){
+	jointTarget targets[PID_NUM_JOINTS];
+	stepTrajectory(&armTrajectory, targets);
+	lowerAngleTenths = targets[0].position; // where moveStraight starts from
+	upperAngleTenths = targets[1].position;
+	trackJoints(targets);
+}
+
 /**
  * @brief gets the current, calibrated joint angle of the passed joint number
  * @param  joint 1 or 2 of the joint to get the angle for
@@ -136,13 +483,29 @@ void serviceArm(){
  * @return angle of joint in degrees (generally 0 to 180)
  */
 float getJointAngle(int joint){
-	float result;
-	// calculate angle with linear interpolation
+	return getJointAngleTenths(joint) / (float)TENTHS_PER_DEGREE;
+}
+
+/**
+ * @brief gets the calibrated joint angle without any floating point math
+ * @details looks the pot up in the EEPROM calibration table, or uses the
+ * two point fit if the joints haven't been calibrated
+ * @param  joint 1 or 2 of the joint to get the angle for
+ *
+ * @return angle of joint in tenths of a degree
+ */
+int getJointAngleTenths(int joint){
+	unsigned int adc = getADC(joint == 1 ? JOINT_1_ADC : JOINT_2_ADC);
+	if(jointCalibrationLoaded())
+		return calibratedJointAngle(joint, adc);
+
+	// linear interpolation between the 0 and 90 degree readings
 	if(joint == 1)
-		result = ((float)getADC(JOINT_1_ADC)-JOINT_1_VAL_AT_0)*degreesPerJoint1Val;
+		return ((long)adc - JOINT_1_VAL_AT_0) * 900
+				/ (JOINT_1_VAL_AT_90 - JOINT_1_VAL_AT_0);
 	else
-		result = ((float)getADC(JOINT_2_ADC)-JOINT_2_VAL_AT_0)*degreesPerJoint2Val;
-	return result;
+		return ((long)adc - JOINT_2_VAL_AT_0) * 900
+				/ (JOINT_2_VAL_AT_90 - JOINT_2_VAL_AT_0);
 }
 
 /**
@@ -152,20 +515,18 @@ float getJointAngle(int joint){
  * @return current in mA
  */
 int getCurrent(int joint){
-	unsigned short adc_val = -1; // leave -1 to check for valid numbers
+	adcSample sample;
 	float milliamps = 0;
-	// get adc_val based on channel for the joint
-	if(joint == 1) 	{
-		adc_val = getADC(ADC0D) - 49; // take off a zero offset
-	}
-	else if(joint == 2){
-		adc_val = getADC(ADC1D) - 49; // take off a zero offset
-	}
+	// get the sample based on channel for the joint
+	if(joint == 1)
+		getADCSample(ADC0D, &sample);
+	else if(joint == 2)
+		getADCSample(ADC1D, &sample);
+	else
+		return 0;
 
-	// convert to milliamps if valid
-	if(adc_val != -1){
-		milliamps = 4.89 * adc_val - 2500;
-	}
+	// take off a zero offset and convert to milliamps
+	milliamps = 4.89 * ((float)sample.value / (1 << sample.bits) - 49) - 2500;
 	return milliamps;
 
 }
@@ -202,14 +563,93 @@ float getAverageCurrent(int command,int current){//takes in a command and a curr
 }
 
 /**
- * @brief updates globals with new desired ones
+ * @brief moves the joints to new desired angles along a minimum jerk trajectory
  * @param  lowerJoint position for the lower joint 1
  * @param  upperJoint position for the upper joint 2
  *
  */
 void setJointAngles(int lowerJoint, int upperJoint){
-	lowerAngle = lowerJoint;
-	upperAngle = upperJoint;
+	clearMotionQueue(); // a direct command takes over from the queue
+	stopPlayback(); // and from a playback
+	moveJoints(lowerJoint * TENTHS_PER_DEGREE, upperJoint * TENTHS_PER_DEGREE, TRAJ_MIN_JERK);
+}
+
+/**
+ * @brief plans a move of both joints for serviceArm to follow
+ * @details a move that interrupts another move or a line, or follows one
+ * in the motion queue, starts from the setpoint so it carries on smoothly,
+ * otherwise it starts where the arm is.
+ * Asking again for the move under way, or the one just finished, leaves it
+ * be, so callers can re-command the same target every loop.
+ * @param lowerTenths joint 1 angle to end at in tenths of a degree
+ * @param upperTenths joint 2 angle to end at in tenths of a degree
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ *
+ * @return control ticks until the move ends, its length if it is new
+ */
+unsigned int moveJoints(int lowerTenths, int upperTenths, unsigned char profile){
+	unsigned int ticks;
+	int start[PID_NUM_JOINTS] = {lowerAngleTenths, upperAngleTenths};
+	int end[PID_NUM_JOINTS] = {lowerTenths, upperTenths};
+	if(!lineMoving && lowerTenths == armTrajectory.end[0]
+			&& upperTenths == armTrajectory.end[1]
+			&& (!armTrajectory.active || armTrajectory.profile == profile)){
+		// already going there, the last tick left gives out the end angles
+		ticks = trajectoryTicksLeft(&armTrajectory);
+		return ticks ? ticks - 1 : 0;
+	}
+	// queued segments carry on from the last one's end, even once it is
+	// done, or the setpoint would jump back to the lagging arm each corner
+	if(!lineMoving && !armTrajectory.active && !motionQueueRunning){
+		start[0] = getJointTenths(1);
+		start[1] = getJointTenths(2);
+	}
+	lineMoving = FALSE;
+	armTrajectory.active = FALSE; // don't let serviceArm see a half planned move
+	if(profile == TRAJ_TRAPEZOID)
+		ticks = planTrapezoid(&armTrajectory, start, end);
+	else if(profile == TRAJ_STEP)
+		ticks = planTrajectory(&armTrajectory, end, end); // a move that goes nowhere
+	else
+		ticks = planTrajectory(&armTrajectory, start, end);
+	lowerAngle = tenthsToDegrees(lowerTenths);
+	upperAngle = tenthsToDegrees(upperTenths);
+	return ticks;
+}
+
+/**
+ * @brief steps one joint and prints its response every tick
+ * @details runs serviceArm itself, then prints how many ticks it took to
+ * get inside the PID deadband for good
+ * @param joint 1 or 2
+ * @param angle angle to step the joint to in degrees
+ * @param ticks how many control ticks to log
+ */
+void logStepResponse(int joint, int angle, unsigned int ticks){
+	int setPoint = angle * TENTHS_PER_DEGREE;
+	unsigned int tick = 0;
+	unsigned int settleTick = 0;
+	unsigned long lastTick = timerCount;
+
+	// a real step, not a trajectory
+	if(joint == 1)
+		moveJoints(setPoint, upperAngleTenths, TRAJ_STEP);
+	else
+		moveJoints(lowerAngleTenths, setPoint, TRAJ_STEP);
+	printf("Tick,Setpoint(tenths),Angle(tenths),Output\n\r");
+	while(tick < ticks){
+		serviceArm();
+		// one line per control tick
+		if(timerCount == lastTick)
+			continue;
+		lastTick = timerCount;
+		int actual = getJointTenths(joint);
+		printf("%u,%d,%d,%d\n\r", tick, setPoint, actual, pidControllers[joint - 1].output);
+		if(!betweenTwoVals(setPoint - actual, -PID_DEADBAND, PID_DEADBAND))
+			settleTick = tick + 1;
+		tick++;
+	}
+	printf("Settled after %u ticks\n\r", settleTick);
 }
 
 /**
@@ -218,25 +658,39 @@ void setJointAngles(int lowerJoint, int upperJoint){
  * @return time in seconds
  */
 float getTimeSeconds(){
-	return timerCount/100.0;
+	return timerCount/(float)controlTicksPerSec;
+}
+
+/**
+ * @brief gets when the move or line the arm is on should end
+ * @details from the plan, not from where the arm actually is
+ *
+ * @return time in seconds, now if the arm isn't moving
+ */
+float getArrivalTime(){
+	long ticks = trajectoryTicksLeft(&armTrajectory);
+	if(lineMoving){
+		// the line moves lineSpeed * TENTHS_PER_MM of lineProgress each tick
+		long left = (long)lineLength * controlTicksPerSec - lineProgress;
+		long step = (long)lineSpeed * TENTHS_PER_MM;
+		ticks = (left > 0 && step > 0) ? (left + step - 1) / step : 0;
+	}
+	return getTimeSeconds() + (float)ticks / controlTicksPerSec;
 }
 
 /**
  * @brief calculates forward kinematics for arm and updates global position
  */
 void calcXY(){
-	// calc joint angles
-	float Joint1Angle = getJointAngle(1)*RADS_PER_DEGREE;
-	float Joint2Angle = getJointAngle(2)*RADS_PER_DEGREE;
-
-	// forward kinematics to calculate coordinates of end of link 2
-	float x1 = LINK_2_Length*cos(Joint1Angle);
-	float y1 = LINK_1_Length+(LINK_2_Length*sin(Joint1Angle));
-
-	// forward kinematics to calculate coordinates of end effector link 3
-	x_coord = x1 + LINK_3_Length*cos(Joint2Angle -(3.14159/2.0)+ Joint1Angle);
-	y_coord = y1 + LINK_3_Length*sin(Joint2Angle-(3.14159/2.0)+ Joint1Angle);
+	forwardKinematicsFloat(getJointAngle(1), getJointAngle(2), &x_coord, &y_coord);
+}
 
+/**
+ * @brief fixed point forward kinematics, updates x_pos and y_pos
+ * @details cheap enough to run every control tick
+ */
+void calcXYFixed(){
+	forwardKinematics(getJointTenths(1), getJointTenths(2), &x_pos, &y_pos);
 }
 
 /**
@@ -249,8 +703,8 @@ void calcXY(){
  */
 BOOL inPosition(int theta1, int theta2){
 	// return if both joints are within a tolerance of +-2
-	return( (betweenTwoVals(theta1-getJointAngle(1),-2,2))
-			&& (betweenTwoVals(theta2-getJointAngle(2),-2,2)) );
+	return( (betweenTwoVals(theta1*TENTHS_PER_DEGREE-getJointTenths(1),-20,20))
+			&& (betweenTwoVals(theta2*TENTHS_PER_DEGREE-getJointTenths(2),-20,20)) );
 }
 /**
  * @brief checks if the arm is in desired position
@@ -258,6 +712,12 @@ BOOL inPosition(int theta1, int theta2){
  * @return true if in desired position
  */
 BOOL doneMoving(){
+	// a straight line move also has to have run out of line, and a joint
+	// move out of trajectory
+	if(lineMoving && lineProgress < (long)lineLength * controlTicksPerSec)
+		return FALSE;
+	if(armTrajectory.active || motionQueueDepth())
+		return FALSE;
 	return inPosition(lowerAngle,upperAngle);
 }
 
@@ -267,16 +727,65 @@ BOOL doneMoving(){
  * @param y desired y position
  */
 void setPosition(float x, float y){
-	// subtract Link1 (vertical) length from requested y value
-	float _y = y - LINK_1_Length;
-	// optimization - cache these calculations
-	float xx = pow(x,2);
-	float yy = pow(_y,2);
-
-	float theta1 = atan2f(_y,x)+acos((xx+yy+L2L2-L3L3)/(2*LINK_2_Length*(sqrt((xx+yy)))));
-	float theta2 = acos(((L2L2)+(L3L3)-(xx+yy))/(2*LINK_2_Length*LINK_3_Length))-(3.14159/2);
-	lowerAngle = theta1*DEGREES_TO_RADIANS;//sets results to the global variable lowerAngle
-	upperAngle = theta2*DEGREES_TO_RADIANS;//sets results to the global variable upperAngle
+	movePosition(x, y, TRAJ_MIN_JERK); // minimum jerk move there, not a step
+}
+
+/**
+ * @brief calculates IK values and plans a joint move there
+ * @param x desired x position in mm
+ * @param y desired y position in mm
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ *
+ * @return control ticks until the move ends, 0 if the point is out of reach
+ */
+unsigned int movePosition(float x, float y, unsigned char profile){
+	int theta1, theta2;
+	int xTenths = x * TENTHS_PER_MM;
+	int yTenths = y * TENTHS_PER_MM;
+	// interpolate the flash grid over the conveyor, otherwise solve in fixed
+	// point, out of reach points leave the setpoint alone
+	if(inverseKinematicsGrid(xTenths, yTenths, &theta1, &theta2)
+			|| inverseKinematics(xTenths, yTenths, &theta1, &theta2)){
+		clearMotionQueue(); // a direct command takes over from the queue
+		stopPlayback(); // and from a playback
+		return moveJoints(theta1, theta2, profile);
+	}
+	return 0;
+}
+
+/**
+ * @brief moves the end effector to a position along a straight line
+ * @details starts from where the current setpoint puts the end effector.
+ * serviceArm steps the joint setpoints along the line through the inverse
+ * Jacobian, so there is no IK solve per tick.
+ * @param x desired x position in mm
+ * @param y desired y position in mm
+ * @param speed speed along the line in mm/s
+ */
+void moveStraight(float x, float y, int speed){
+	int theta1, theta2;
+	int xTenths = x * TENTHS_PER_MM;
+	int yTenths = y * TENTHS_PER_MM;
+	// out of reach points leave the setpoint alone, same as setPosition
+	if(!inverseKinematics(xTenths, yTenths, &theta1, &theta2))
+		return;
+
+	int startX, startY;
+	forwardKinematics(lowerAngleTenths, upperAngleTenths, &startX, &startY);
+	long dx = xTenths - startX;
+	long dy = yTenths - startY;
+	clearMotionQueue(); // a direct command takes over from the queue
+	stopPlayback(); // and from a playback
+	lineMoving = FALSE; // don't let serviceArm see a half set line
+	armTrajectory.active = FALSE; // the line takes over from any joint move
+	lineStartX = startX;
+	lineStartY = startY;
+	lineEndX = xTenths;
+	lineEndY = yTenths;
+	lineLength = isqrt32(dx * dx + dy * dy);
+	lineSpeed = speed;
+	lineProgress = 0;
+	lineMoving = TRUE;
 }
 
 /**
@@ -0,0 +1,193 @@
+/** @brief relay feedback PID auto-tuner
+ *
+ * @file autotune.c
+ *
+ * Puts one joint in a relay feedback loop (Astrom-Hagglund): the joint is
+ * driven by plus or minus AUTOTUNE_RELAY around its gravity feedforward
+ * depending on which side of its starting angle it is. It settles into an
+ * oscillation at its ultimate period, and the ultimate gain comes from the
+ * relay size over the swing. The classic Ziegler-Nichols rules turn those
+ * into PID gains, which are saved in EEPROM and loaded by initArm.
+ *
+ * @author cpbove@wpi.edu
+ * @date 10-Mar-2016
+ * @version 1.0
+ */
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h"
+#include "include/arm.h"
+#include "include/PID.h"
+#include "include/jointState.h"
+#include "include/kinematics.h"
+#include "include/autotune.h"
+#include <avr/eeprom.h>
+#include <stdint.h>
+#include "math.h"
+
+/**
+ * @var tunedMagic
+ * TUNED_MAGIC once tuned gains have been written
+ *
+ * @var tunedGains
+ * Kp, Ki, Kd in setConst units for each joint
+ */
+uint16_t EEMEM tunedMagic;
+float EEMEM tunedGains[PID_NUM_JOINTS][3];
+
+/**
+ * @brief runs a relay experiment on one joint around where it is now
+ * @details the other joint is held by its PID. Blocks until the
+ * oscillation has been measured, the joint swings too far or it times out.
+ * @param joint 1 or 2
+ * @param result where to put the measurements
+ *
+ * @return TRUE if the oscillation was measured
+ */
+BOOL relayExperiment(int joint, relayResult *result){
+	unsigned char tuned = joint - 1;
+	unsigned char other = 1 - tuned;
+	int angles[PID_NUM_JOINTS];
+	int center = getJointTenths(joint);
+	jointTarget hold = {getJointTenths(other + 1), 0, 0};
+	BOOL high = TRUE;
+	unsigned char cycles = 0;
+	unsigned int tick = 0;
+	unsigned int lastRise = 0;
+	unsigned long periodSum = 0;
+	long swingSum = 0;
+	int maxAngle = center;
+	int minAngle = center;
+	unsigned long lastTick = timerCount;
+
+	while(cycles < AUTOTUNE_SKIP_CYCLES + AUTOTUNE_CYCLES){
+		// one relay update per control tick
+		if(timerCount == lastTick)
+			continue;
+		lastTick = timerCount;
+		if(++tick >= AUTOTUNE_TIMEOUT){
+			stopMotors();
+			printf("Joint %d didn't oscillate\n\r", joint);
+			return FALSE;
+		}
+
+		updateJointState();
+		angles[0] = getJointTenths(1);
+		angles[1] = getJointTenths(2);
+		int error = center - angles[tuned];
+		if(!betweenTwoVals(error, -AUTOTUNE_MAX_SWING, AUTOTUNE_MAX_SWING)){
+			stopMotors();
+			printf("Joint %d swung too far\n\r", joint);
+			return FALSE;
+		}
+		if(angles[tuned] > maxAngle)
+			maxAngle = angles[tuned];
+		if(angles[tuned] < minAngle)
+			minAngle = angles[tuned];
+
+		// switch the relay once the error is past the hysteresis, each
+		// switch to high ends one oscillation
+		if(!high && error > AUTOTUNE_HYSTERESIS){
+			high = TRUE;
+			if(lastRise){
+				if(cycles >= AUTOTUNE_SKIP_CYCLES){
+					periodSum += tick - lastRise;
+					swingSum += maxAngle - minAngle;
+				}
+				cycles++;
+			}
+			lastRise = tick;
+			maxAngle = angles[tuned];
+			minAngle = angles[tuned];
+		}
+		else if(high && error < -AUTOTUNE_HYSTERESIS)
+			high = FALSE;
+
+		driveLink(joint + 1, gravityFeedforward(joint, angles[0], angles[1])
+				+ (high ? AUTOTUNE_RELAY : -AUTOTUNE_RELAY));
+		// hold the other joint where it was
+		driveLink(other + 2, updatePIDController(&pidControllers[other], &hold, angles[other],
+				gravityFeedforward(other + 1, angles[0], angles[1])));
+	}
+	stopMotors();
+
+	// describing function of a relay with hysteresis: Ku = 4d / (pi sqrt(a^2 - h^2))
+	float amplitude = swingSum / 2.0 / AUTOTUNE_CYCLES;
+	if(amplitude <= AUTOTUNE_HYSTERESIS){
+		printf("Joint %d oscillation too small to measure\n\r", joint);
+		return FALSE;
+	}
+	result->amplitude = amplitude;
+	result->ultimateGain = 4.0 * AUTOTUNE_RELAY
+			/ (M_PI * sqrt(amplitude * amplitude - (float)AUTOTUNE_HYSTERESIS * AUTOTUNE_HYSTERESIS));
+	result->ultimatePeriod = (float)periodSum / AUTOTUNE_CYCLES;
+	return TRUE;
+}
+
+/**
+ * @brief tunes each joint the user asks for over the debug USART, then
+ * uses and saves the new gains
+ */
+void autotuneJoints(){
+	float gains[PID_NUM_JOINTS][3];
+	BOOL tuned = FALSE;
+	relayResult result;
+	int joint;
+	char c;
+
+	// start from what is in use, so a skipped joint keeps its gains
+	gains[0][0] = pidConsts.Kp_L;
+	gains[0][1] = pidConsts.Ki_L;
+	gains[0][2] = pidConsts.Kd_L;
+	gains[1][0] = pidConsts.Kp_H;
+	gains[1][1] = pidConsts.Ki_H;
+	gains[1][2] = pidConsts.Kd_H;
+
+	for(joint = 1; joint <= PID_NUM_JOINTS; joint++){
+		printf("Tune joint %d? It will oscillate about where it is. Send y or n\n\r", joint);
+		do {
+			c = getCharDebug();
+		} while(c != 'y' && c != 'n');
+		if(c == 'n' || !relayExperiment(joint, &result))
+			continue;
+
+		// Ziegler-Nichols: Kp = 0.6 Ku, Ti = Tu / 2, Td = Tu / 8, with Ku
+		// per degree and the times in PID_BASE_RATE ticks like setConst wants
+		float ultimateGain = result.ultimateGain * TENTHS_PER_DEGREE;
+		float ultimatePeriod = result.ultimatePeriod * PID_BASE_RATE / controlTicksPerSec;
+		gains[joint - 1][0] = 0.6 * ultimateGain;
+		gains[joint - 1][1] = 1.2 * ultimateGain / ultimatePeriod;
+		gains[joint - 1][2] = 0.075 * ultimateGain * ultimatePeriod;
+		printf("Joint %d: Ku %.2f/deg, Tu %.2f s, swing %.1f deg\n\r", joint,
+				ultimateGain, result.ultimatePeriod / controlTicksPerSec,
+				result.amplitude / TENTHS_PER_DEGREE);
+		printf("Kp %.3f, Ki %.4f, Kd %.3f\n\r", gains[joint - 1][0],
+				gains[joint - 1][1], gains[joint - 1][2]);
+		tuned = TRUE;
+	}
+	if(!tuned)
+		return;
+
+	// joint 1 is link 2 to setConst, joint 2 is link 3
+	setConst(2, gains[0][0], gains[0][1], gains[0][2]);
+	setConst(3, gains[1][0], gains[1][1], gains[1][2]);
+	eeprom_update_word(&tunedMagic, 0);
+	eeprom_update_block(gains, tunedGains, sizeof(gains));
+	eeprom_update_word(&tunedMagic, TUNED_MAGIC);
+	printf("Gains saved\n\r");
+}
+
+/**
+ * @brief uses the tuned gains saved in EEPROM, if there are any
+ *
+ * @return TRUE if saved gains were loaded
+ */
+BOOL loadTunedGains(){
+	float gains[PID_NUM_JOINTS][3];
+	if(eeprom_read_word(&tunedMagic) != TUNED_MAGIC)
+		return FALSE;
+	eeprom_read_block(gains, tunedGains, sizeof(gains));
+	setConst(2, gains[0][0], gains[0][1], gains[0][2]);
+	setConst(3, gains[1][0], gains[1][1], gains[1][2]);
+	return TRUE;
+}
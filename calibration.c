@@ -0,0 +1,203 @@
+/** @brief joint pot calibration
+ *
+ * @file calibration.c
+ *
+ * Piecewise linear ADC to angle tables for the joint pots, built from a few
+ * poses recorded over the debug USART and kept in EEPROM. The tables hold an
+ * angle every CAL_STEP counts and readings in between are interpolated, so a
+ * lookup is two EEPROM reads and no float math.
+ *
+ * @author cpbove@wpi.edu
+ * @date 7-Mar-2016
+ * @version 1.0
+ */
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h"
+#include "include/arm.h"
+#include "include/ADC.h"
+#include "include/kinematics.h"
+#include "include/calibration.h"
+#include <avr/eeprom.h>
+#include <stdint.h>
+
+/**
+ * @var calMagic
+ * CAL_MAGIC once valid tables have been written
+ *
+ * @var calTables
+ * angle in tenths of a degree at every CAL_STEP ADC counts for each joint
+ */
+uint16_t EEMEM calMagic;
+uint16_t EEMEM calTables[2][CAL_TABLE_SIZE];
+
+/**
+ * @var calLoaded
+ * TRUE when calTables can be used
+ */
+BOOL calLoaded;
+
+/**
+ * @brief checks EEPROM for saved calibration tables
+ *
+ * @return TRUE if the tables are there and will be used
+ */
+BOOL loadJointCalibration(){
+	calLoaded = (eeprom_read_word(&calMagic) == CAL_MAGIC);
+	return calLoaded;
+}
+
+/**
+ * @brief checks if getJointAngleTenths is using the calibration tables
+ *
+ * @return TRUE if the tables were loaded or just built
+ */
+BOOL jointCalibrationLoaded(){
+	return calLoaded;
+}
+
+/**
+ * @brief looks an ADC reading up in a joint's calibration table
+ * @param joint 1 or 2
+ * @param adc joint pot reading, 0 to 1023
+ *
+ * @return angle of the joint in tenths of a degree
+ */
+int calibratedJointAngle(int joint, unsigned int adc){
+	const uint16_t *table = calTables[joint == 1 ? 0 : 1];
+	unsigned char index = adc >> CAL_SHIFT;
+	unsigned char frac = adc & (CAL_STEP - 1);
+	int low = (int16_t)eeprom_read_word(&table[index]);
+	if(!frac)
+		return low;
+	// interpolate to the next entry
+	int high = (int16_t)eeprom_read_word(&table[index + 1]);
+	return low + (high - low) * frac / CAL_STEP;
+}
+
+/**
+ * @brief averages fresh readings of an ADC channel
+ * @param channel the ADC channel to read
+ *
+ * @return average of CAL_SAMPLES readings, in 10 bit counts
+ */
+unsigned int averageADC(int channel){
+	adcSample sample;
+	unsigned int total = 0;
+	unsigned char samples = 0;
+	getADCSample(channel, &sample);
+	unsigned long lastCount = sample.count;
+	// only count each sample the scanner publishes once
+	while(samples < CAL_SAMPLES){
+		getADCSample(channel, &sample);
+		if(sample.count != lastCount){
+			lastCount = sample.count;
+			total += sample.value >> sample.bits;
+			samples++;
+		}
+	}
+	return (total + CAL_SAMPLES / 2) / CAL_SAMPLES;
+}
+
+/**
+ * @brief fills a joint's EEPROM table from its recorded poses
+ * @details ADC values outside the recorded poses are extrapolated from the
+ * closest two
+ * @param joint 1 or 2
+ * @param counts ADC reading at each pose, increasing
+ * @param angles angle of each pose in tenths of a degree
+ * @param poses number of poses, at least 2
+ */
+void buildCalibrationTable(int joint, const unsigned int *counts, const int *angles, unsigned char poses){
+	uint16_t *table = calTables[joint == 1 ? 0 : 1];
+	unsigned char segment = 0;
+	unsigned int i;
+	for(i = 0; i < CAL_TABLE_SIZE; i++){
+		unsigned int adc = i << CAL_SHIFT;
+		// move to the segment this reading falls in, the first and last
+		// segments also cover everything past them
+		while(segment < poses - 2 && adc >= counts[segment + 1])
+			segment++;
+		long angle = angles[segment] + (long)(angles[segment + 1] - angles[segment])
+				* ((int)adc - (int)counts[segment]) / (int)(counts[segment + 1] - counts[segment]);
+		eeprom_update_word(&table[i], (int)angle);
+	}
+}
+
+/**
+ * @brief records the poses of one joint
+ * @param joint 1 or 2
+ * @param counts where to put the ADC reading of each pose, increasing
+ * @param angles where to put the angle of each pose in tenths of a degree
+ *
+ * @return number of poses recorded
+ */
+unsigned char recordJointPoses(int joint, unsigned int *counts, int *angles){
+	const int joint1Angles[CAL_POSES] = JOINT_1_CAL_ANGLES;
+	const int joint2Angles[CAL_POSES] = JOINT_2_CAL_ANGLES;
+	const int *poseAngles = (joint == 1) ? joint1Angles : joint2Angles;
+	unsigned char poses = 0;
+	unsigned char pose, i;
+	char c;
+
+	for(pose = 0; pose < CAL_POSES; pose++){
+		printf("Move joint %d to %d degrees, then send y (or n to skip)\n\r",
+				joint, poseAngles[pose]);
+		do {
+			c = getCharDebug();
+		} while(c != 'y' && c != 'n');
+		if(c == 'n')
+			continue;
+
+		unsigned int count = averageADC(joint == 1 ? JOINT_1_ADC : JOINT_2_ADC);
+		printf("%u counts\n\r", count);
+		// insert in order of counts, the pot may run either way
+		for(i = poses; i > 0 && counts[i - 1] > count; i--){
+			counts[i] = counts[i - 1];
+			angles[i] = angles[i - 1];
+		}
+		counts[i] = count;
+		angles[i] = poseAngles[pose] * TENTHS_PER_DEGREE;
+		poses++;
+	}
+	// poses too close together would make a useless slope
+	for(i = 1; i < poses; i++){
+		if(counts[i] - counts[i - 1] < CAL_MIN_COUNTS){
+			printf("Poses %u and %u counts are too close\n\r", counts[i - 1], counts[i]);
+			return 0;
+		}
+	}
+	return poses;
+}
+
+/**
+ * @brief records poses of both joints over the debug USART and rebuilds the
+ * EEPROM tables
+ * @details the motors are stopped so the arm can be moved by hand. Poses can
+ * be skipped, but each joint needs at least two.
+ */
+void calibrateJoints(){
+	unsigned int counts[2][CAL_POSES];
+	int angles[2][CAL_POSES];
+	unsigned char poses[2];
+	int joint;
+
+	stopMotors();
+	printf("Calibrating joints, motors are off\n\r");
+	for(joint = 1; joint <= 2; joint++){
+		poses[joint - 1] = recordJointPoses(joint, counts[joint - 1], angles[joint - 1]);
+		if(poses[joint - 1] < 2){
+			printf("Joint %d needs 2 good poses, calibration not saved\n\r", joint);
+			return;
+		}
+	}
+
+	// invalidate the old tables while the new ones are written
+	eeprom_update_word(&calMagic, 0);
+	calLoaded = FALSE;
+	for(joint = 1; joint <= 2; joint++)
+		buildCalibrationTable(joint, counts[joint - 1], angles[joint - 1], poses[joint - 1]);
+	eeprom_update_word(&calMagic, CAL_MAGIC);
+	calLoaded = TRUE;
+	printf("Calibration saved\n\r");
+}
@@ -0,0 +1,410 @@
+/** @brief conveyor block tracker
+ *
+ * @file conveyor.c
+ *
+ * The front of the block passes the front sensor at 0 mm and the back
+ * sensor at Distance_Between_IR, and its back end passes the same spots
+ * one block length later. With the belt at a steady speed every edge time
+ * t at position p is t = a + b p, plus c for the back end of the block, so
+ * a least squares fit of a, b = 1 / velocity and c = length / velocity to
+ * however many edges there are gives the speed and when the front reaches
+ * the arm. The edge times come from the ADC ISR at the IR sample rate. The
+ * IR channels are converted between the tick triggered sweeps rather than
+ * in them, so they aren't rounded to the control tick, and with all four
+ * edges the one spare measurement shows how far to trust them.
+ *
+ * @author cpbove@wpi.edu
+ * @date 13-Mar-2016
+ * @version 1.0
+ */
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h"
+#include "include/arm.h"
+#include "include/ADC.h"
+#include "include/FSM.h"
+#include "include/conveyor.h"
+#include "math.h"
+
+/**
+ * @struct conveyorEdge
+ * one sensor seeing or losing the block
+ *
+ * @var conveyorEdge::position
+ * mm from the front sensor
+ * @var conveyorEdge::trailing
+ * TRUE if it was the back end of the block going past
+ * @var conveyorEdge::clock
+ * Timer0 counts when the ISR saw it
+ */
+typedef struct {
+	float position;
+	BOOL trailing;
+	unsigned long clock;
+} conveyorEdge;
+
+/**
+ * @struct trackedBlock
+ * one block the tracker is following
+ *
+ * @var trackedBlock::edges
+ * edges of the block, in the order they happened
+ * @var trackedBlock::edgeCount
+ * edges in trackedBlock::edges
+ * @var trackedBlock::seen
+ * which edges have happened: bit 0 front sensor on, 1 front off, 2 back
+ * on, 3 back off
+ * @var trackedBlock::nearest
+ * closest calibrated front IR reading in mm while locating it
+ * @var trackedBlock::pastNearest
+ * fresh front IR readings since trackedBlock::nearest
+ * @var trackedBlock::estimate
+ * what's known about the block so far
+ */
+typedef struct {
+	conveyorEdge edges[CONVEYOR_MAX_EDGES];
+	unsigned char edgeCount;
+	unsigned char seen;
+	int nearest;
+	unsigned char pastNearest;
+	conveyorEstimate estimate;
+} trackedBlock;
+
+/**
+ * @var conveyorBlocks
+ * ring of the blocks being followed, oldest at conveyorHead
+ *
+ * @var conveyorHead
+ * index in conveyorBlocks of the oldest block
+ *
+ * @var conveyorCount
+ * blocks being followed
+ *
+ * @var lastIRCount
+ * sample count of the last front IR reading used to locate a block
+ */
+trackedBlock conveyorBlocks[CONVEYOR_MAX_BLOCKS];
+unsigned char conveyorHead;
+unsigned char conveyorCount;
+unsigned long lastIRCount;
+
+/**
+ * @var conveyorBlocksSeen
+ * blocks the front sensor has seen since initConveyorTracker
+ *
+ * @var conveyorBlocksTimedOut
+ * blocks given up on after CONVEYOR_BLOCK_TIMEOUT
+ *
+ * @var conveyorBlocksLost
+ * blocks there was no room to follow
+ */
+unsigned int conveyorBlocksSeen;
+unsigned int conveyorBlocksTimedOut;
+unsigned int conveyorBlocksLost;
+
+/**
+ * @brief gets the IR reading for a distance, the inverse of IRDist
+ * @param mm distance from the sensor in mm
+ *
+ * @return 10 bit ADC reading
+ */
+unsigned short irCounts(int mm){
+	return 67870L / (mm + 4) + 3;
+}
+
+/**
+ * @brief has the ADC ISR timestamp both IR sensors seeing and losing blocks
+ * @details the IR channels go in the ADC background, between the tick
+ * triggered sweeps, so they are sampled more often than the control tick
+ */
+void initConveyorTracker(){
+	setADCBackground(IR_FRONT_PIN, TRUE);
+	setADCBackground(IR_BACK_PIN, TRUE);
+	// closer is a higher reading, so seeing a block is a rising edge
+	setADCEdgeDetect(IR_FRONT_PIN, irCounts(CONVEYOR_EDGE_ON), irCounts(CONVEYOR_EDGE_OFF));
+	setADCEdgeDetect(IR_BACK_PIN, irCounts(CONVEYOR_EDGE_ON), irCounts(CONVEYOR_EDGE_OFF));
+	resetConveyorTracker();
+}
+
+/**
+ * @brief forgets every block so the next edges start a new one
+ */
+void resetConveyorTracker(){
+	clearADCEdges();
+	conveyorHead = 0;
+	conveyorCount = 0;
+}
+
+/**
+ * @brief gets one of the blocks being followed
+ * @param index 0 for the oldest
+ *
+ * @return the block
+ */
+trackedBlock *conveyorBlock(unsigned char index){
+	return &conveyorBlocks[(conveyorHead + index) % CONVEYOR_MAX_BLOCKS];
+}
+
+/**
+ * @brief solves a small symmetric system by Gaussian elimination
+ * @param matrix n by n matrix, left as scratch
+ * @param rhs right hand side, left as scratch
+ * @param x where to put the solution
+ * @param n 2 or 3
+ *
+ * @return FALSE if the system is singular
+ */
+BOOL solveConveyor(float matrix[3][3], float *rhs, float *x, unsigned char n){
+	unsigned char i, j, k;
+	for(i = 0; i < n; i++){
+		if(fabs(matrix[i][i]) < 1e-9)
+			return FALSE; // positive definite when solvable, so no pivoting
+		for(j = i + 1; j < n; j++){
+			float factor = matrix[j][i] / matrix[i][i];
+			for(k = i; k < n; k++)
+				matrix[j][k] -= factor * matrix[i][k];
+			rhs[j] -= factor * rhs[i];
+		}
+	}
+	for(i = n; i-- > 0;){
+		x[i] = rhs[i];
+		for(k = i + 1; k < n; k++)
+			x[i] -= matrix[i][k] * x[k];
+		x[i] /= matrix[i][i];
+	}
+	return TRUE;
+}
+
+/**
+ * @brief least squares fit of a block's edges to it moving at a steady
+ * speed, and the intercept and confidence from it
+ * @param block the block to fit
+ */
+void fitConveyor(trackedBlock *block){
+	float normal[3][3] = {{0}};
+	float scratch[3][3];
+	float rhs[3] = {0};
+	float coeffs[3], spread[3];
+	float row[3];
+	float seconds = 1.0 / ((OCR0A + 1) * (float)controlTicksPerSec); // per Timer0 count
+	const float armPosition = Distance_Between_IR + Distance_IR_To_Arm;
+	const conveyorEdge *edges = block->edges;
+	unsigned char n = (block->seen & (BIT(1) | BIT(3))) ? 3 : 2; // c needs an off edge
+	unsigned char i, j, k;
+
+	// both sensors have to have seen it for a speed
+	if((block->seen & (BIT(0) | BIT(2))) != (BIT(0) | BIT(2)))
+		return;
+
+	// normal equations, times from the first edge to keep the floats small
+	for(i = 0; i < block->edgeCount; i++){
+		float t = (edges[i].clock - edges[0].clock) * seconds;
+		row[0] = 1;
+		row[1] = edges[i].position;
+		row[2] = edges[i].trailing;
+		for(j = 0; j < n; j++){
+			rhs[j] += row[j] * t;
+			for(k = 0; k < n; k++)
+				normal[j][k] += row[j] * row[k];
+		}
+	}
+	for(j = 0; j < 3; j++)
+		for(k = 0; k < 3; k++)
+			scratch[j][k] = normal[j][k];
+	if(!solveConveyor(scratch, rhs, coeffs, n) || coeffs[1] <= 0)
+		return;
+
+	// variance of the intercept is sigma^2 g' (X'X)^-1 g with g = (1, arm, 0)
+	float g[3] = {1, armPosition, 0};
+	for(j = 0; j < 3; j++)
+		for(k = 0; k < 3; k++)
+			scratch[j][k] = normal[j][k];
+	if(!solveConveyor(scratch, g, spread, n))
+		return;
+	float variance = spread[0] + armPosition * spread[1];
+
+	// edge times are good to about a sample, spread evenly over it, unless
+	// the spare edges show they are worse than that
+	unsigned int rate = getADCSampleRate(IR_FRONT_PIN);
+	float sigma = (rate ? 1.0 / rate : 1.0 / controlTicksPerSec) / sqrt(12);
+	float sigma2 = sigma * sigma;
+	if(block->edgeCount > n){
+		float residuals = 0;
+		for(i = 0; i < block->edgeCount; i++){
+			float t = (edges[i].clock - edges[0].clock) * seconds;
+			float error = t - coeffs[0] - coeffs[1] * edges[i].position;
+			if(n == 3 && edges[i].trailing)
+				error -= coeffs[2];
+			residuals += error * error;
+		}
+		residuals /= block->edgeCount - n;
+		if(residuals > sigma2)
+			sigma2 = residuals;
+	}
+
+	conveyorEstimate *fit = &block->estimate;
+	fit->velocity = 1 / coeffs[1];
+	fit->intercept = edges[0].clock * seconds + coeffs[0] + coeffs[1] * armPosition;
+	fit->length = (n == 3) ? coeffs[2] * fit->velocity : 0;
+	fit->confidence = 1 - sqrt(sigma2 * variance) / CONVEYOR_INTERCEPT_TOLERANCE;
+	if(fit->confidence < 0)
+		fit->confidence = 0;
+	fit->edges = block->edgeCount;
+	fit->fitted = TRUE;
+}
+
+/**
+ * @brief finds the block an edge belongs to, the oldest one still waiting
+ * for it. A block coming onto the belt starts a new one.
+ * @param bit which edge, as in trackedBlock::seen
+ *
+ * @return the block, 0 if there isn't one
+ */
+trackedBlock *blockForEdge(unsigned char bit){
+	trackedBlock *block;
+	unsigned char i;
+	if(bit == 0){
+		conveyorBlocksSeen++;
+		if(conveyorCount >= CONVEYOR_MAX_BLOCKS){
+			conveyorBlocksLost++;
+			return 0;
+		}
+		block = conveyorBlock(conveyorCount++);
+		block->estimate.id = conveyorBlocksSeen;
+		block->edgeCount = 0;
+		block->seen = 0;
+		block->nearest = 999;
+		block->pastNearest = 0;
+		block->estimate.located = FALSE;
+		block->estimate.fitted = FALSE;
+		return block;
+	}
+	// off edges follow that sensor's on edge, and the back sensor comes
+	// after the front one
+	unsigned char before = (bit == 3) ? BIT(2) : BIT(0);
+	for(i = 0; i < conveyorCount; i++){
+		block = conveyorBlock(i);
+		if((block->seen & before) && !(block->seen & BIT(bit)))
+			return block;
+	}
+	return 0;
+}
+
+/**
+ * @brief takes the closest front IR reading as a block goes past, the same
+ * way CalcBlockX used to, and works out its x from it
+ * @param block the block in front of the front sensor
+ */
+void locateBlock(trackedBlock *block){
+	adcSample sample;
+	// only look at each oversampled IR reading once
+	getADCSample(IR_FRONT_PIN, &sample);
+	if(sample.count != lastIRCount){
+		lastIRCount = sample.count;
+		int reading = calibratedIRVal(IRDist(IR_FRONT_PIN)); //calibrated distance
+		// note - make sure we don't get values outside of conveyor range
+		if((reading <= block->nearest) && (reading >= 85)){
+			block->nearest = reading;
+			block->pastNearest = 0;
+		}
+		else
+			block->pastNearest++;
+	}
+	// done once the readings have climbed back up or the block has gone
+	if(block->pastNearest >= IR_Samples_Past_Min || (block->seen & BIT(1))){
+		block->estimate.x = (block->nearest < 999) ? block->nearest + X_IR_Offset + Fudged_X : Center_X;
+		block->estimate.located = TRUE;
+	}
+}
+
+/**
+ * @brief takes the edges the ADC ISR found and refits the blocks they
+ * belong to, and measures how far away the block in front of the front
+ * sensor is. Call every time through the main loop.
+ */
+void serviceConveyorTracker(){
+	adcEdge edge;
+	trackedBlock *block;
+	unsigned char i;
+	while(getADCEdge(&edge)){
+		unsigned char bit = (edge.channel == IR_BACK_PIN ? 2 : 0) + (edge.rising ? 0 : 1);
+		block = blockForEdge(bit);
+		if(!block || block->edgeCount >= CONVEYOR_MAX_EDGES)
+			continue;
+		block->seen |= BIT(bit);
+		block->edges[block->edgeCount].position = (edge.channel == IR_BACK_PIN) ? Distance_Between_IR : 0;
+		block->edges[block->edgeCount].trailing = !edge.rising;
+		block->edges[block->edgeCount].clock = edge.clock;
+		block->edgeCount++;
+		fitConveyor(block);
+	}
+
+	for(i = 0; i < conveyorCount; i++){
+		block = conveyorBlock(i);
+		if(!block->estimate.located){
+			locateBlock(block);
+			break; // only one block is in front of the front sensor
+		}
+	}
+
+	// give up on the oldest block if it never made it to the back sensor
+	if(conveyorCount){
+		block = conveyorBlock(0);
+		long timeout = (long)CONVEYOR_BLOCK_TIMEOUT * (OCR0A + 1) * controlTicksPerSec;
+		if(!block->estimate.fitted && (long)(adcClock() - block->edges[0].clock) > timeout){
+			conveyorBlocksTimedOut++;
+			dropConveyorBlock();
+		}
+	}
+}
+
+/**
+ * @brief checks if there is a block on the belt
+ *
+ * @return TRUE while the tracker is following at least one block
+ */
+BOOL conveyorBlockSeen(){
+	return conveyorCount != 0;
+}
+
+/**
+ * @brief gets how many blocks the tracker is following
+ *
+ * @return blocks from the front sensor to the arm
+ */
+unsigned char conveyorBlockCount(){
+	return conveyorCount;
+}
+
+/**
+ * @brief gets what the tracker knows about the oldest block on the belt
+ * @param estimate where to put it
+ *
+ * @return FALSE if there are no blocks
+ */
+BOOL getConveyorEstimate(conveyorEstimate *estimate){
+	if(!conveyorCount)
+		return FALSE;
+	*estimate = conveyorBlock(0)->estimate;
+	return TRUE;
+}
+
+/**
+ * @brief stops following the oldest block, once it is picked or missed,
+ * so the next one becomes the oldest
+ */
+void dropConveyorBlock(){
+	if(!conveyorCount)
+		return;
+	conveyorHead = (conveyorHead + 1) % CONVEYOR_MAX_BLOCKS;
+	conveyorCount--;
+}
+
+/**
+ * @brief prints how many blocks the tracker followed, gave up on after
+ * CONVEYOR_BLOCK_TIMEOUT and had no room for
+ */
+void printConveyorStats(){
+	printf("Blocks seen %u, timed out %u, lost %u, on the belt %u\n\r",
+			conveyorBlocksSeen, conveyorBlocksTimedOut, conveyorBlocksLost, conveyorCount);
+}
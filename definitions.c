@@ -36,3 +36,27 @@ int abs(int a){
 BOOL betweenTwoVals(int value, int lower, int upper){
 	return (value <= upper && value >= lower);
 }
+
+/**
+ * @brief zeroes Timer1 and runs it at the CPU clock for counting cycles
+ * @note Timer1 isn't used by anything else, so benchmarks get it to themselves
+ */
+void startCycleCount(){
+	TCCR1A = 0; // normal counting mode
+	TCCR1B = 0; // stop while resetting
+	TCNT1 = 0;
+	TIFR1 = BIT(TOV1); // clear any old overflow
+	TCCR1B = BIT(CS10); // no prescaler, one count per cycle
+}
+
+/**
+ * @brief gets the CPU cycles since startCycleCount
+ *
+ * @return cycles counted, 65535 if Timer1 overflowed
+ */
+unsigned int readCycleCount(){
+	unsigned int cycles = TCNT1;
+	if(TIFR1 & BIT(TOV1))
+		return 0xFFFF;
+	return cycles;
+}
@@ -0,0 +1,103 @@
+/** @brief PROGMEM inverse kinematics grid
+ *
+ * @file ikGrid.c
+ *
+ * Generated by tools/ikGridGen.c with a 10 mm step, do not edit by hand.
+ */
+
+#include "include/ikGrid.h"
+
+const int ikGrid[IK_GRID_ROWS][IK_GRID_COLS][2] PROGMEM = {
+	// y = 120 mm
+	{{587,-507}, {578,-468}, {566,-428}, {553,-388}, {539,-347}, {523,-305},
+	 {506,-261}, {488,-217}, {469,-172}, {449,-125}, {427,-76}, {405,-26},
+	 {381,27}, {355,82}, {327,141}, {298,204}, {265,272}, {229,348},
+	 {186,435}, {134,541}, {58,694}, {32767,32767}, {32767,32767}},
+	// y = 130 mm
+	{{646,-515}, {632,-475}, {616,-435}, {599,-394}, {582,-352}, {563,-310},
+	 {544,-267}, {524,-222}, {503,-177}, {481,-130}, {458,-81}, {434,-31},
+	 {409,22}, {382,78}, {354,136}, {323,199}, {290,267}, {253,342},
+	 {210,429}, {158,533}, {84,681}, {32767,32767}, {32767,32767}},
+	// y = 140 mm
+	{{705,-518}, {685,-478}, {665,-438}, {645,-397}, {624,-355}, {603,-313},
+	 {581,-269}, {559,-225}, {536,-179}, {512,-132}, {488,-83}, {462,-33},
+	 {436,20}, {408,75}, {379,134}, {347,196}, {313,264}, {275,340},
+	 {232,425}, {179,529}, {106,675}, {32767,32767}, {32767,32767}},
+	// y = 150 mm
+	{{762,-518}, {737,-478}, {713,-438}, {689,-397}, {665,-355}, {641,-312},
+	 {617,-269}, {592,-224}, {567,-179}, {542,-132}, {516,-83}, {490,-33},
+	 {462,20}, {433,76}, {402,134}, {370,197}, {335,265}, {296,340},
+	 {252,426}, {199,530}, {125,676}, {32767,32767}, {32767,32767}},
+	// y = 160 mm
+	{{816,-514}, {787,-474}, {758,-434}, {731,-393}, {704,-352}, {677,-309},
+	 {651,-266}, {624,-221}, {598,-176}, {571,-129}, {543,-80}, {515,-30},
+	 {486,23}, {456,78}, {425,137}, {391,200}, {355,268}, {316,343},
+	 {271,429}, {216,534}, {140,683}, {32767,32767}, {32767,32767}},
+	// y = 170 mm
+	{{867,-505}, {833,-467}, {801,-427}, {770,-387}, {740,-345}, {711,-303},
+	 {683,-260}, {655,-216}, {626,-171}, {598,-124}, {569,-75}, {540,-25},
+	 {510,28}, {478,83}, {446,142}, {411,205}, {374,273}, {334,349},
+	 {288,436}, {232,543}, {152,697}, {32767,32767}, {32767,32767}},
+	// y = 180 mm
+	{{913,-494}, {875,-456}, {840,-417}, {807,-377}, {775,-336}, {743,-295},
+	 {713,-252}, {683,-208}, {653,-163}, {623,-116}, {593,-68}, {563,-17},
+	 {531,36}, {499,91}, {465,150}, {430,213}, {392,282}, {350,359},
+	 {302,447}, {245,556}, {159,721}, {32767,32767}, {32767,32767}},
+	// y = 190 mm
+	{{953,-479}, {913,-442}, {876,-403}, {840,-364}, {806,-324}, {773,-283},
+	 {741,-241}, {709,-197}, {678,-152}, {647,-106}, {615,-57}, {584,-7},
+	 {551,46}, {518,101}, {483,160}, {447,224}, {407,293}, {364,371},
+	 {315,461}, {255,574}, {160,757}, {32767,32767}, {32767,32767}},
+	// y = 200 mm
+	{{989,-460}, {947,-424}, {908,-387}, {870,-349}, {834,-310}, {800,-269},
+	 {766,-227}, {733,-184}, {701,-139}, {668,-93}, {636,-45}, {603,5},
+	 {570,58}, {535,114}, {499,173}, {462,237}, {421,308}, {377,387},
+	 {326,480}, {262,598}, {145,822}, {32767,32767}, {32767,32767}},
+	// y = 210 mm
+	{{1019,-439}, {976,-404}, {935,-368}, {897,-331}, {860,-292}, {824,-252},
+	 {789,-211}, {755,-168}, {722,-124}, {688,-78}, {654,-30}, {621,20},
+	 {586,73}, {551,129}, {514,189}, {475,254}, {433,325}, {387,406},
+	 {334,502}, {265,629}, {32767,32767}, {32767,32767}, {32767,32767}},
+	// y = 220 mm
+	{{1045,-416}, {1001,-382}, {960,-347}, {920,-311}, {882,-273}, {845,-233},
+	 {810,-193}, {775,-150}, {740,-106}, {706,-60}, {671,-13}, {636,38},
+	 {601,91}, {564,147}, {526,208}, {486,273}, {443,346}, {395,430},
+	 {339,530}, {263,671}, {32767,32767}, {32767,32767}, {32767,32767}},
+	// y = 230 mm
+	{{1066,-390}, {1022,-357}, {980,-323}, {940,-288}, {901,-251}, {864,-212},
+	 {827,-172}, {792,-130}, {756,-86}, {721,-41}, {686,7}, {650,58},
+	 {613,111}, {576,168}, {537,229}, {496,296}, {451,371}, {401,457},
+	 {340,565}, {252,728}, {32767,32767}, {32767,32767}, {32767,32767}},
+	// y = 240 mm
+	{{1082,-361}, {1038,-330}, {997,-297}, {956,-263}, {917,-226}, {880,-188},
+	 {842,-149}, {806,-107}, {770,-64}, {734,-18}, {698,30}, {661,80},
+	 {624,134}, {586,191}, {545,253}, {503,322}, {456,399}, {403,490},
+	 {337,607}, {214,839}, {32767,32767}, {32767,32767}, {32767,32767}},
+	// y = 250 mm
+	{{1095,-331}, {1051,-301}, {1010,-269}, {970,-235}, {931,-200}, {892,-162},
+	 {855,-123}, {818,-82}, {781,-39}, {745,6}, {708,54}, {671,105},
+	 {633,159}, {593,217}, {552,281}, {507,351}, {458,432}, {402,529},
+	 {327,663}, {32767,32767}, {32767,32767}, {32767,32767}, {32767,32767}},
+	// y = 260 mm
+	{{1104,-300}, {1061,-270}, {1020,-239}, {980,-206}, {941,-171}, {903,-134},
+	 {865,-95}, {828,-55}, {791,-12}, {753,34}, {716,82}, {678,133},
+	 {639,188}, {598,247}, {555,312}, {509,385}, {458,471}, {396,577},
+	 {304,744}, {32767,32767}, {32767,32767}, {32767,32767}, {32767,32767}}
+};
+
+const unsigned char ikGridCellOK[IK_GRID_ROWS - 1][IK_GRID_CELL_BYTES] PROGMEM = {
+	{0xFF, 0xFF, 0x03},
+	{0xFF, 0xFF, 0x03},
+	{0xFF, 0xFF, 0x03},
+	{0xFF, 0xFF, 0x03},
+	{0xFF, 0xFF, 0x03},
+	{0xFF, 0xFF, 0x03},
+	{0xFF, 0xFF, 0x03},
+	{0xFF, 0xFF, 0x01},
+	{0xFF, 0xFF, 0x01},
+	{0xFF, 0xFF, 0x01},
+	{0xFF, 0xFF, 0x01},
+	{0xFF, 0xFF, 0x00},
+	{0xFF, 0xFF, 0x00},
+	{0xFF, 0xFF, 0x00}
+};
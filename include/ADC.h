@@ -0,0 +1,272 @@
+/** @brief ADC scanner definitions
+ *
+ * @file ADC.h
+ *
+ * The ADC ISR walks a list of channels on its own and keeps the latest
+ * reading of each one in a snapshot table, so getADC() never has to wait
+ * on the mux. These are the extras on top of the RBELib ADC functions.
+ *
+ * @author cpbove@wpi.edu
+ * @date 28-Jan-2016
+ * @version 1.1
+ */
+
+#ifndef INCLUDE_ADC_H_
+#define INCLUDE_ADC_H_
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h" // for F_CLOCK
+
+/**
+ * @def ADC_NUM_CHANNELS
+ * number of single ended channels on the ADC mux
+ * @def ADC_MAX_SCAN
+ * most channels the scan list can hold
+ */
+#define ADC_NUM_CHANNELS 8
+#define ADC_MAX_SCAN ADC_NUM_CHANNELS
+
+/**
+ * @def ADC_DEFAULT_SCAN
+ * channels scanned from initADC: motor currents (0,1), joint pots (2,3)
+ * and the conveyor IR sensors (4,5)
+ * @def ADC_DEFAULT_SCAN_LENGTH
+ * number of channels in ADC_DEFAULT_SCAN
+ */
+#define ADC_DEFAULT_SCAN {ADC0D, ADC1D, ADC2D, ADC3D, ADC4D, ADC5D}
+#define ADC_DEFAULT_SCAN_LENGTH 6
+
+/**
+ * @def ADC_CONVERSIONS_PER_SEC
+ * conversions per second with the /128 ADC clock and 13 clocks each
+ * @def ADC_MAX_OVERSAMPLE_BITS
+ * most extra bits of resolution a channel can be oversampled to
+ */
+#define ADC_CONVERSIONS_PER_SEC (F_CLOCK / 128 / 13)
+#define ADC_MAX_OVERSAMPLE_BITS 2
+
+/**
+ * @def ADC_BACKGROUND_COUNTS
+ * Timer0 counts that have to be left before the next tick to start a
+ * background conversion. A conversion takes about 1.6, the rest covers the
+ * ISR getting to it late.
+ */
+#define ADC_BACKGROUND_COUNTS 3
+
+/**
+ * @def ADC_EDGE_QUEUE_SIZE
+ * threshold crossings the ISR can hold until they are read, a power of 2
+ */
+#define ADC_EDGE_QUEUE_SIZE 8
+
+/**
+ * @enum adcTriggers
+ * what starts each sweep of the scan list
+ * @var ADC_FREE_RUN
+ * the ISR starts the next sweep as soon as one finishes
+ * @var ADC_TIMER0_TRIGGER
+ * Timer0 compare match A starts each sweep, so one time-aligned set of
+ * samples is taken per control tick. Background channels are left out of
+ * the sweep and converted in the time between sweeps.
+ */
+enum adcTriggers {
+	ADC_FREE_RUN,
+	ADC_TIMER0_TRIGGER
+};
+
+/**
+ * @struct adcSample
+ * coherent copy of one channel's latest conversion
+ *
+ * @var adcSample::value
+ * the reading, 10 bits plus adcSample::bits of oversampling
+ * @var adcSample::bits
+ * extra bits of resolution in the value (0 for a plain 10 bit reading)
+ * @var adcSample::count
+ * samples published on the channel so far
+ * @var adcSample::stamp
+ * timerCount when the conversion finished
+ */
+typedef struct {
+	unsigned short value;
+	unsigned char bits;
+	unsigned long count;
+	unsigned long stamp;
+} adcSample;
+
+/**
+ * @struct adcEdge
+ * a channel crossing its edge thresholds, stamped by the ISR
+ *
+ * @var adcEdge::channel
+ * the channel that crossed
+ * @var adcEdge::rising
+ * TRUE if it went up through the high threshold, FALSE if down through
+ * the low one
+ * @var adcEdge::clock
+ * Timer0 counts (1024 clocks each) since setupTimer when the sample that
+ * crossed was published
+ */
+typedef struct {
+	unsigned char channel;
+	BOOL rising;
+	unsigned long clock;
+} adcEdge;
+
+/**
+ * @struct adcStats
+ * instrumentation counters for one channel
+ *
+ * @var adcStats::conversions
+ * conversions the ADC finished on the channel, counting each oversample
+ * @var adcStats::reads
+ * times the channel was read through getADC or getADCSample
+ * @var adcStats::retries
+ * reads that had to retry because the ISR published mid-copy
+ * @var adcStats::stallCounts
+ * Timer0 counts (1024 clocks each) getADC spent waiting on the mux
+ * @var adcStats::sampleAge
+ * control ticks since the channel's last sample was published
+ */
+typedef struct {
+	unsigned long conversions;
+	unsigned long reads;
+	unsigned long retries;
+	unsigned long stallCounts;
+	unsigned long sampleAge;
+} adcStats;
+
+/**
+ * @brief copies the latest sample of a channel without masking interrupts
+ * @details retries the copy if the ISR published a new sample mid-read
+ * @param channel the ADC channel to read
+ * @param sample where to put the copy
+ */
+void getADCSample(int channel, adcSample *sample);
+/**
+ * @brief gets how many times readers had to retry a sample copy
+ *
+ * @return number of retried reads since initADC
+ */
+unsigned long getADCReadRetries();
+/**
+ * @brief sets how many extra bits a channel is oversampled to
+ * @details the ISR sums 4^bits back to back conversions of the channel and
+ * shifts the sum right by bits, giving a 10+bits wide result
+ * @param channel the ADC channel to configure
+ * @param bits 0 for plain 10 bit readings, up to ADC_MAX_OVERSAMPLE_BITS
+ */
+void setADCOversample(int channel, unsigned char bits);
+/**
+ * @brief gets how many conversions one tick triggered sweep takes
+ * @details each channel costs 4^bits conversions, at ADC_CONVERSIONS_PER_SEC.
+ * Background channels aren't part of the sweep.
+ *
+ * @return conversions per sweep
+ */
+unsigned int getADCSweepConversions();
+/**
+ * @brief gets how often a channel publishes a new sample
+ * @details background channels share what is left of each tick after the
+ * sweep, so theirs is an estimate
+ * @param channel the ADC channel to check
+ *
+ * @return samples per second, 0 if the channel isn't scanned
+ */
+unsigned int getADCSampleRate(int channel);
+/**
+ * @brief moves a channel out of the tick triggered sweep, to be converted
+ * between sweeps instead, or back into it
+ * @details for channels that don't need to be in step with the control
+ * tick. Their samples come as often as the time between sweeps allows,
+ * which shortens the sweep and can be more often than once a tick. With
+ * ADC_FREE_RUN they are scanned with the rest.
+ * @param channel the ADC channel, added to the scan list if it isn't in it
+ * @param background TRUE to convert it between sweeps
+ */
+void setADCBackground(int channel, BOOL background);
+/**
+ * @brief picks what starts each sweep of the scan list
+ * @param trigger one of the adcTriggers
+ */
+void setADCTrigger(unsigned char trigger);
+/**
+ * @brief gets what starts each sweep of the scan list
+ *
+ * @return one of the adcTriggers
+ */
+unsigned char getADCTrigger();
+/**
+ * @brief checks if a full sweep finished since the last time this was asked
+ *
+ * @return TRUE once per completed sweep of the scan list
+ */
+BOOL adcSweepReady();
+/**
+ * @brief gets the number of completed sweeps of the scan list
+ *
+ * @return sweeps since initADC
+ */
+unsigned long getADCSweepCount();
+/**
+ * @brief timestamps a channel crossing a pair of thresholds
+ * @details the ISR checks every sample it publishes on the channel, so the
+ * stamps are as fine as the channel's sample rate rather than the control
+ * tick. The gap between the thresholds keeps noise from making extra edges.
+ * @param channel the ADC channel to watch
+ * @param high 10 bit reading the channel has to reach for a rising edge,
+ * 0 to stop watching the channel
+ * @param low 10 bit reading the channel has to drop below for a falling edge
+ */
+void setADCEdgeDetect(int channel, unsigned short high, unsigned short low);
+/**
+ * @brief takes the oldest edge the ISR found off its queue
+ * @param edge where to put the edge
+ *
+ * @return FALSE if there are no edges waiting
+ */
+BOOL getADCEdge(adcEdge *edge);
+/**
+ * @brief drops any edges waiting on the queue
+ */
+void clearADCEdges();
+/**
+ * @brief gets a fine grained time stamp
+ *
+ * @return Timer0 counts (1024 clocks each) since setupTimer
+ */
+unsigned long adcClock();
+/**
+ * @brief gets the instrumentation counters for one channel
+ * @param channel the ADC channel to get counters for
+ * @param stats where to put the counters
+ */
+void getADCStats(int channel, adcStats *stats);
+/**
+ * @brief zeroes the read, retry and stall counters of every channel
+ */
+void resetADCStats();
+/**
+ * @brief prints the counters of every scanned channel over the debug USART
+ */
+void printADCStats();
+/**
+ * @brief Replaces the list of channels the ADC ISR cycles through.
+ * @param channels array of channel numbers (0-7) to scan in order
+ * @param length number of channels in the array (1 to ADC_MAX_SCAN)
+ */
+void setADCScanList(const unsigned char *channels, unsigned char length);
+/**
+ * @brief Adds one channel to the end of the scan list if it isn't there.
+ * @param channel the ADC channel to start scanning
+ */
+void addADCScanChannel(int channel);
+/**
+ * @brief checks if a channel is in the scan list and has a reading
+ * @param channel the ADC channel to check
+ *
+ * @return TRUE if getADC can return a real sample for the channel
+ */
+BOOL adcChannelReady(int channel);
+
+#endif /* INCLUDE_ADC_H_ */
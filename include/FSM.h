@@ -34,9 +34,77 @@ enum FSMStates {
 	GenerateTrajectoryDropFar,
 	GenerateTrajectoryDropClose,
 	ExecuteDropMotion,
-	DropBlock
+	DropBlock,
+	FSM_NUM_STATES
 };
 
+/**
+ * @def FSM_NAME_LENGTH
+ * longest state name plus its terminator
+ * @def FSM_TRACE_SIZE
+ * transitions the trace buffer holds, a power of 2
+ */
+#define FSM_NAME_LENGTH 28
+#define FSM_TRACE_SIZE 32
+
+/**
+ * @struct fsmState
+ * what a state does, kept in flash
+ *
+ * @var fsmState::name
+ * name printed in the stats and the trace
+ * @var fsmState::entry
+ * called once on the way into the state, can be 0
+ * @var fsmState::run
+ * called every time through the FSM while in the state, returns the state
+ * to go to next, which is the same state to stay
+ * @var fsmState::exit
+ * called once on the way out of the state, can be 0
+ */
+typedef struct {
+	char name[FSM_NAME_LENGTH];
+	void (*entry)();
+	unsigned char (*run)();
+	void (*exit)();
+} fsmState;
+
+/**
+ * @struct fsmDwell
+ * how long a state (or a whole pick cycle) lasts each time
+ *
+ * @var fsmDwell::visits
+ * times it has been left
+ * @var fsmDwell::minCounts
+ * shortest stay in Timer0 counts (1024 clocks each)
+ * @var fsmDwell::maxCounts
+ * longest stay in Timer0 counts
+ * @var fsmDwell::totalCounts
+ * all the stays added up in Timer0 counts
+ */
+typedef struct {
+	unsigned int visits;
+	unsigned long minCounts;
+	unsigned long maxCounts;
+	unsigned long totalCounts;
+} fsmDwell;
+
+/**
+ * @struct fsmTransition
+ * one entry of the transition trace
+ *
+ * @var fsmTransition::from
+ * state that was left
+ * @var fsmTransition::to
+ * state that was entered
+ * @var fsmTransition::clock
+ * Timer0 counts since setupTimer when it happened
+ */
+typedef struct {
+	unsigned char from;
+	unsigned char to;
+	unsigned long clock;
+} fsmTransition;
+
 /**
  * @def IR_FRONT_PIN
  * the analog pin for the first/front IR sensor on the conveyor
@@ -45,6 +113,14 @@ enum FSMStates {
  */
 #define IR_FRONT_PIN 4
 #define IR_BACK_PIN 5
+/**
+ * @def IR_OVERSAMPLE_BITS
+ * extra bits of resolution the IR sensors are oversampled to
+ * @def IR_Samples_Past_Min
+ * fresh IR samples above the minimum before the block x is locked in
+ */
+#define IR_OVERSAMPLE_BITS 2
+#define IR_Samples_Past_Min 10
 
 /**
  * @def X_Spacer
@@ -85,8 +161,6 @@ enum FSMStates {
  */
 #define Fudged_X 13
 /**
- * @def Distance_Threshold
- * distance in mm to trip the IR sensor
  * @def Distance_Between_IR
  * distance in mm between IR sensors
  * @def Distance_IR_To_Arm
@@ -94,12 +168,14 @@ enum FSMStates {
  * @def X_IR_Offset
  * additional distance from IR sensors to Arm frame origin
  */
-#define Distance_Threshold 200
 #define Distance_Between_IR 64.7
 #define Distance_IR_To_Arm 130
 #define X_IR_Offset 76.81 + X_Spacer
 
 /**
+ * @def Max_Late
+ * seconds late over a block the arm can be and still grab it, any later
+ * and it goes for the next block
  * @def Time_To_Move
  * The time before the block grab time to start moving down
  * @def Time_To_Grab
@@ -107,10 +183,26 @@ enum FSMStates {
  * @def Time_To_Close
  * The time the gripper needs to firmly close around the block
  */
+#define Max_Late 0.2
 #define Time_To_Move -0.3
 #define Time_To_Grab -0.55
 #define Time_To_Close 0.9
 
+/**
+ * @def Grab_Speed
+ * speed in mm/s of the straight dip onto the block
+ * @def Lift_Speed
+ * speed in mm/s of the straight lift off the conveyor
+ */
+#define Grab_Speed 250
+#define Lift_Speed 250
+
+/**
+ * @def Move_Time_Timeout
+ * seconds printMoveTimes gives a move to get there
+ */
+#define Move_Time_Timeout 5.0
+
 /**
  * @def Heavy_Current_Threshold
  * currents higher than this mean we lifted a heavy block
@@ -119,7 +211,30 @@ enum FSMStates {
 
 /**
  * @brief runs FSM for the final project
+ * @details runs the current state's handler from the state table, and on a
+ * change of state its exit handler and the next state's entry handler,
+ * timing and tracing the transition
  */
 void finiteStateMachine();
+/**
+ * @brief prints the shortest, longest and mean time spent in each state and
+ * in a whole pick cycle over the debug USART
+ */
+void printFSMStats();
+/**
+ * @brief prints the latest transitions, oldest first, over the debug USART
+ */
+void printFSMTrace();
+/**
+ * @brief zeroes the dwell times and empties the trace
+ */
+void resetFSMStats();
+/**
+ * @brief times the drop and return moves with step setpoints, minimum jerk
+ * and trapezoidal trajectories, and prints planned and actual times
+ * @details runs serviceArm itself. Each time is from the move starting
+ * until doneMoving.
+ */
+void printMoveTimes();
 
 #endif /* INCLUDE_FSM_H_ */
@@ -0,0 +1,212 @@
+/** @brief joint PID controllers
+ *
+ * @file PID.h
+ *
+ * One pidController per joint, run in integer math. Angles are in tenths of
+ * a degree and gains are Q12 output counts per tenth of a degree. setConst and
+ * calcPID from RBELib are kept as wrappers around the controllers.
+ *
+ * @author cpbove@wpi.edu
+ * @date 9-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_PID_H_
+#define INCLUDE_PID_H_
+
+#include "RBELib/RBELib.h"
+
+/**
+ * @def PID_NUM_JOINTS
+ * number of joints with a controller
+ * @def PID_GAIN_SHIFT
+ * fraction bits in the gains
+ */
+#define PID_NUM_JOINTS 2
+#define PID_GAIN_SHIFT 12
+
+/**
+ * @def PID_BASE_RATE
+ * control rate in Hz the Ki and Kd given to setConst are per tick of, they
+ * are rescaled for the rate the loop actually runs at
+ */
+#define PID_BASE_RATE 100
+
+/**
+ * @def PID_DEADBAND
+ * error in tenths of a degree the controller stops driving inside of
+ * @def PID_OUTPUT_LIMIT
+ * biggest output driveLink takes
+ * @def PID_DERIVATIVE_SHIFT
+ * the derivative filter moves 1/2^PID_DERIVATIVE_SHIFT of the way to each
+ * new rate, about 4 ticks of smoothing
+ * @def PID_DERIVATIVE_FRACTION
+ * fraction bits kept in the filtered rate
+ */
+#define PID_DEADBAND 20
+#define PID_OUTPUT_LIMIT 2048
+#define PID_DERIVATIVE_SHIFT 2
+#define PID_DERIVATIVE_FRACTION 4
+
+/**
+ * @def PID_GRAVITY
+ * gravity constant for the feedforward (arbitrary units)
+ * @def LINK_2_MASS
+ * mass of link 2 for the feedforward (arbitrary units)
+ * @def LINK_3_MASS
+ * mass of link 3 for the feedforward (arbitrary units)
+ * @def JOINT_1_STATIC_TORQUE
+ * output added in the direction of motion to get joint 1 moving
+ * @def JOINT_2_STATIC_TORQUE
+ * output added in the direction of motion to get joint 2 moving
+ */
+#define PID_GRAVITY 10
+#define LINK_2_MASS 20
+#define LINK_3_MASS 5
+#define JOINT_1_STATIC_TORQUE 200
+#define JOINT_2_STATIC_TORQUE 150
+
+/**
+ * @def LINK_2_GRAVITY
+ * output that holds link 2 up when it is horizontal
+ * @def LINK_3_GRAVITY
+ * output that holds link 3 up when it is horizontal
+ */
+#define LINK_2_GRAVITY ((long)PID_GRAVITY * LINK_2_MASS)
+#define LINK_3_GRAVITY ((long)PID_GRAVITY * LINK_3_MASS)
+
+/**
+ * @struct pidController
+ * gains, limits and state of one joint's controller
+ *
+ * @var pidController::kp
+ * proportional gain, Q12 per tenth of a degree
+ * @var pidController::ki
+ * integral gain, Q12 per tenth of a degree tick
+ * @var pidController::kd
+ * derivative gain, Q12 per tenth of a degree per tick
+ * @var pidController::kv
+ * velocity feedforward gain, Q12 per tenth of a degree per second
+ * @var pidController::ka
+ * acceleration feedforward gain, Q12 per tenth of a degree per second^2
+ * @var pidController::staticTorque
+ * output added in the direction of the error to get the joint moving
+ * @var pidController::outputLimit
+ * biggest output magnitude
+ * @var pidController::errorSum
+ * sum of the errors since the setpoint changed, only added to while the
+ * output isn't saturated in the same direction
+ * @var pidController::rate
+ * filtered rate the joint is moving at, tenths of a degree per tick with
+ * PID_DERIVATIVE_FRACTION fraction bits
+ * @var pidController::lastPos
+ * measured angle from the last update
+ * @var pidController::lastSetPoint
+ * setpoint from the last update
+ * @var pidController::started
+ * FALSE until lastPos holds a real angle
+ * @var pidController::output
+ * output from the last update
+ */
+typedef struct {
+	long kp;
+	long ki;
+	long kd;
+	long kv;
+	long ka;
+	int staticTorque;
+	int outputLimit;
+	long errorSum;
+	long rate;
+	int lastPos;
+	int lastSetPoint;
+	BOOL started;
+	int output;
+} pidController;
+
+/**
+ * @struct jointTarget
+ * where a joint should be this tick and how it should be moving
+ *
+ * @var jointTarget::position
+ * desired angle in tenths of a degree
+ * @var jointTarget::velocity
+ * desired rate in tenths of a degree per second, 0 when holding
+ * @var jointTarget::acceleration
+ * desired acceleration in tenths of a degree per second^2
+ */
+typedef struct {
+	int position;
+	int velocity;
+	int acceleration;
+} jointTarget;
+
+/**
+ * @var pidControllers
+ * controller for each joint, joint 1 first
+ */
+extern pidController pidControllers[PID_NUM_JOINTS];
+
+/**
+ * @brief sets a controller's gains
+ * @details Ki and Kd are per PID_BASE_RATE tick and are scaled to the
+ * control loop rate, so a gain set keeps its meaning in seconds
+ * @param pid the controller to set
+ * @param Kp proportional gain in output per degree
+ * @param Ki integral gain in output per degree tick
+ * @param Kd derivative gain in output per degree per tick
+ */
+void setPIDGains(pidController *pid, float Kp, float Ki, float Kd);
+/**
+ * @brief sets a controller's trajectory feedforward gains
+ * @param pid the controller to set
+ * @param Kv output per degree per second of desired velocity
+ * @param Ka output per degree per second^2 of desired acceleration
+ */
+void setPIDFeedforward(pidController *pid, float Kv, float Ka);
+/**
+ * @brief clears a controller's error sum
+ * @param pid the controller to reset
+ */
+void resetPIDController(pidController *pid);
+/**
+ * @brief runs one update of a controller
+ * @details the derivative acts on the filtered measured rate so setpoint
+ * steps don't kick it, and the integrator stops while the output is
+ * saturated in the direction of the error. While the target is moving the
+ * deadband is ignored and setpoint changes don't reset the integrator.
+ * @param pid the controller to update
+ * @param target desired angle, velocity and acceleration
+ * @param actPos measured angle in tenths of a degree
+ * @param feedforward output added on top of the PID and trajectory terms
+ *
+ * @return output for driveLink, within the controller's limit
+ */
+int updatePIDController(pidController *pid, const jointTarget *target, int actPos, int feedforward);
+/**
+ * @brief gets the output that holds a joint up against gravity
+ * @details each term is a link's gravity output at horizontal times the cos
+ * of its angle with horizontal, looked up in the kinematics sine table
+ * @param joint 1 or 2
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ *
+ * @return gravity feedforward output
+ */
+int gravityFeedforward(int joint, int theta1, int theta2);
+/**
+ * @brief floating point gravity feedforward, what the table replaced
+ * @param joint 1 or 2
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ *
+ * @return gravity feedforward output
+ */
+int gravityFeedforwardFloat(int joint, int theta1, int theta2);
+/**
+ * @brief sweeps the joint ranges and prints the cycles each gravity
+ * feedforward takes and the worst difference between them
+ */
+void printGravityCycles();
+
+#endif /* INCLUDE_PID_H_ */
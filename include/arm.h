@@ -9,6 +9,8 @@
  */
 
 #include "RBELib/RBELib.h"
+#include "include/PID.h"
+#include "include/trajectory.h"
 
 #ifndef INCLUDE_ARM_H_
 #define INCLUDE_ARM_H_
@@ -38,6 +40,24 @@
 #define JOINT_1_VAL_AT_0 	180
 #define JOINT_1_VAL_AT_90 	550
 
+/**
+ * @def CONTROL_DEFAULT_RATE
+ * control loop rate in Hz setupTimer starts with, 100, 250, 500 or 1000
+ */
+#define CONTROL_DEFAULT_RATE 100
+
+/**
+ * @def MOTION_QUEUE_SIZE
+ * segments the motion queue holds, a power of 2
+ */
+#define MOTION_QUEUE_SIZE 8
+
+/**
+ * @def CURRENT_OVERSAMPLE_BITS
+ * extra bits of resolution the motor current channels are oversampled to
+ */
+#define CURRENT_OVERSAMPLE_BITS 1
+
 /**
  * @def LINK_1_Length
  * length of Link 1 in mm
@@ -59,25 +79,184 @@ enum currentCommands {
 	retrieveAverageCurrent
 };
 
+/**
+ * @struct motionSegment
+ * one joint move waiting in the motion queue
+ *
+ * @var motionSegment::lower
+ * joint 1 angle to end at in tenths of a degree
+ * @var motionSegment::upper
+ * joint 2 angle to end at in tenths of a degree
+ * @var motionSegment::profile
+ * TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ * @var motionSegment::blend
+ * how close in tenths of a degree the move before has to get to its end
+ * before this one starts, 0 to wait for it to finish
+ * @var motionSegment::last
+ * TRUE if nothing is meant to follow this one, set by endMotionSequence
+ */
+typedef struct {
+	int lower;
+	int upper;
+	unsigned char profile;
+	int blend;
+	BOOL last;
+} motionSegment;
+
+/**
+ * @var timerCount
+ * for keeping time. increments every control tick
+ */
+extern volatile unsigned long timerCount;
+/**
+ * @var controlTicksPerSec
+ * rate serviceArm runs the control loop at (Timer0 compare matches per second)
+ */
+extern unsigned int controlTicksPerSec;
+/**
+ * @var controlOverruns
+ * ticks that came before serviceArm finished the one before them
+ */
+extern volatile unsigned int controlOverruns;
+/**
+ * @var x_pos
+ * x coordinate of the arm from the fixed point FK, in tenths of a mm
+ * @var y_pos
+ * y coordinate of the arm from the fixed point FK, in tenths of a mm
+ */
+extern int x_pos;
+extern int y_pos;
+/**
+ * @var motionQueueUnderruns
+ * times the motion queue ran dry before the end of a sequence
+ */
+extern unsigned int motionQueueUnderruns;
+/**
+ * @var lowerAngleTenths
+ * lower joint setpoint in tenths of a degree
+ * @var upperAngleTenths
+ * upper joint setpoint in tenths of a degree
+ */
+extern int lowerAngleTenths;
+extern int upperAngleTenths;
+
 /**
  * @brief initialize the arm variables
  */
 void initArm();
 /**
- * @brief sets a 100Hz timer up on Timer 0
+ * @brief gives the user a moment to ask for joint calibration ('c'),
+ * encoder calibration ('e') or PID auto-tuning ('t') over the debug USART
+ * @param ticks how many control ticks to wait
+ */
+void offerArmSetup(unsigned int ticks);
+/**
+ * @brief sets the control loop timer up on Timer 0 at controlTicksPerSec
  */
 void setupTimer();
+/**
+ * @brief changes the control loop rate
+ * @details reloads the PID gains so Ki and Kd keep their meaning per second,
+ * and rescales timerCount so getTimeSeconds doesn't jump. With tick
+ * triggered sampling the sweep has to fit in one tick, or every tick would
+ * wait for the sweep and the loop would run slower. initArm leaves only
+ * the two pots in the sweep, 2 conversions, so every rate fits.
+ * @param hz 100, 250, 500 or 1000
+ *
+ * @return TRUE if the rate is supported and was set, FALSE if not or if
+ * the sweep doesn't fit
+ */
+BOOL setControlRate(unsigned int hz);
+/**
+ * @brief prints the overruns and the longest tick since the last call, then
+ * clears them, and how the motion queue is doing
+ */
+void printControlStats();
 /**
  * @brief runs functions critical to arm operation. Call as often as possible.
  */
 void serviceArm();
 /**
- * @brief updates globals with new desired ones
+ * @brief moves the point along the line set by moveStraight one tick and
+ * drives the arm toward it
+ */
+void serviceLine();
+/**
+ * @brief starts the next queued segment once the move before it is done or
+ * within its blend
+ */
+void serviceMotionQueue();
+/**
+ * @brief adds a joint move to the end of the motion queue
+ * @param lowerTenths joint 1 angle to end at in tenths of a degree
+ * @param upperTenths joint 2 angle to end at in tenths of a degree
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ * @param blend how close in tenths of a degree the move before has to get
+ * to its end before this one starts, 0 to wait for it to finish
+ *
+ * @return FALSE if the queue is full
+ */
+BOOL queueJointMove(int lowerTenths, int upperTenths, unsigned char profile, int blend);
+/**
+ * @brief adds a move to an x, y position to the end of the motion queue
+ * @details the IK is solved now, so the control tick doesn't have to
+ * @param x desired x position in mm
+ * @param y desired y position in mm
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ * @param blend how close in tenths of a degree the move before has to get
+ * to its end before this one starts, 0 to wait for it to finish
+ *
+ * @return FALSE if the queue is full or the point is out of reach
+ */
+BOOL queuePosition(float x, float y, unsigned char profile, int blend);
+/**
+ * @brief marks the last queued segment as the end of its sequence, so the
+ * queue running dry after it isn't counted as an underrun
+ */
+void endMotionSequence();
+/**
+ * @brief empties the motion queue, the move under way carries on
+ */
+void clearMotionQueue();
+/**
+ * @brief gets how many segments are waiting in the motion queue
+ *
+ * @return number of queued segments, not counting the one under way
+ */
+unsigned char motionQueueDepth();
+/**
+ * @brief drives the arm to this tick's setpoints of the joint trajectory
+ * @details once the move is over it holds the end angles
+ */
+void serviceTrajectory();
+/**
+ * @brief Drive the arm along a joint trajectory, one tick at a time
+ *
+ * @param targets angle, velocity and acceleration for each joint this tick,
+ * joint 1 first
+ */
+void trackJoints(const jointTarget *targets);
+/**
+ * @brief moves the joints to new desired angles along a minimum jerk trajectory
  * @param  desired lowerJoint position for the lower joint 1
  * @param  desired upperJoint position for the upper joint 2
  *
  */
 void setJointAngles(int lowerJoint, int upperJoint);
+/**
+ * @brief plans a move of both joints for serviceArm to follow
+ * @details a move that interrupts another move or a line, or follows one
+ * in the motion queue, starts from the setpoint so it carries on smoothly,
+ * otherwise it starts where the arm is.
+ * Asking again for the move under way, or the one just finished, leaves it
+ * be, so callers can re-command the same target every loop.
+ * @param lowerTenths joint 1 angle to end at in tenths of a degree
+ * @param upperTenths joint 2 angle to end at in tenths of a degree
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ *
+ * @return control ticks until the move ends, its length if it is new
+ */
+unsigned int moveJoints(int lowerTenths, int upperTenths, unsigned char profile);
 /**
  * @brief gets the current, calibrated joint angle of the passed joint number
  * @param  joint 1 or 2 of the joint to get the angle for
@@ -85,6 +264,15 @@ void setJointAngles(int lowerJoint, int upperJoint);
  * @return angle of joint in degrees (generally 0 to 180)
  */
 float getJointAngle(int joint);
+/**
+ * @brief gets the calibrated joint angle without any floating point math
+ * @details looks the pot up in the EEPROM calibration table, or uses the
+ * two point fit if the joints haven't been calibrated
+ * @param  joint 1 or 2 of the joint to get the angle for
+ *
+ * @return angle of joint in tenths of a degree
+ */
+int getJointAngleTenths(int joint);
 /**
  * @brief allows adding to cumulative average, getting the average, and reseting
  * @param command using currentCommand enum for determining action to take
@@ -99,16 +287,37 @@ float getAverageCurrent(int command, int current);
  * @return current in mA
  */
 int getCurrent(int joint);
+/**
+ * @brief steps one joint and prints its response every tick
+ * @details runs serviceArm itself, then prints how many ticks it took to
+ * get inside the PID deadband for good
+ * @param joint 1 or 2
+ * @param angle angle to step the joint to in degrees
+ * @param ticks how many control ticks to log
+ */
+void logStepResponse(int joint, int angle, unsigned int ticks);
 /**
  * @brief gets the time in seconds
  *
  * @return time in seconds
  */
 float getTimeSeconds();
+/**
+ * @brief gets when the move or line the arm is on should end
+ * @details from the plan, not from where the arm actually is
+ *
+ * @return time in seconds, now if the arm isn't moving
+ */
+float getArrivalTime();
 /**
  * @brief calculates forward kinematics for arm and updates global position
  */
 void calcXY();
+/**
+ * @brief fixed point forward kinematics, updates x_pos and y_pos
+ * @details cheap enough to run every control tick
+ */
+void calcXYFixed();
 /**
  * @brief check if the arm is in the angle position specified
  * @param  theta1 angle of first joint
@@ -130,6 +339,25 @@ BOOL doneMoving();
  * @param y desired y position
  */
 void setPosition(float x, float y);
+/**
+ * @brief calculates IK values and plans a joint move there
+ * @param x desired x position in mm
+ * @param y desired y position in mm
+ * @param profile TRAJ_MIN_JERK, TRAJ_TRAPEZOID or TRAJ_STEP
+ *
+ * @return control ticks until the move ends, 0 if the point is out of reach
+ */
+unsigned int movePosition(float x, float y, unsigned char profile);
+/**
+ * @brief moves the end effector to a position along a straight line
+ * @details starts from where the current setpoint puts the end effector.
+ * serviceArm steps the joint setpoints along the line through the inverse
+ * Jacobian, so there is no IK solve per tick.
+ * @param x desired x position in mm
+ * @param y desired y position in mm
+ * @param speed speed along the line in mm/s
+ */
+void moveStraight(float x, float y, int speed);
 /**
  * @brief uses a polynomial to calibrate the IR distance readings
  * @param IR distance reading in mm
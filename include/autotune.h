@@ -0,0 +1,88 @@
+/** @brief relay feedback PID auto-tuner
+ *
+ * @file autotune.h
+ *
+ * Puts one joint in a relay feedback loop (Astrom-Hagglund) to find its
+ * ultimate gain and period, turns those into PID gains with the
+ * Ziegler-Nichols rules and keeps them in EEPROM.
+ *
+ * @author cpbove@wpi.edu
+ * @date 10-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_AUTOTUNE_H_
+#define INCLUDE_AUTOTUNE_H_
+
+#include "RBELib/RBELib.h"
+
+/**
+ * @def AUTOTUNE_RELAY
+ * output the relay switches by, on top of the gravity feedforward
+ * @def AUTOTUNE_HYSTERESIS
+ * error in tenths of a degree the relay has to cross before it switches
+ * @def AUTOTUNE_MAX_SWING
+ * error in tenths of a degree that aborts the experiment
+ */
+#define AUTOTUNE_RELAY 400
+#define AUTOTUNE_HYSTERESIS 5
+#define AUTOTUNE_MAX_SWING 300
+
+/**
+ * @def AUTOTUNE_SKIP_CYCLES
+ * oscillations thrown away while the relay loop settles
+ * @def AUTOTUNE_CYCLES
+ * oscillations averaged for the ultimate gain and period
+ * @def AUTOTUNE_TIMEOUT
+ * control ticks the experiment can take
+ */
+#define AUTOTUNE_SKIP_CYCLES 2
+#define AUTOTUNE_CYCLES 4
+#define AUTOTUNE_TIMEOUT (30 * controlTicksPerSec)
+
+/**
+ * @def TUNED_MAGIC
+ * written to EEPROM with the tuned gains, so stale EEPROM is ignored
+ */
+#define TUNED_MAGIC 0x7E57
+
+/**
+ * @struct relayResult
+ * what a relay experiment measured
+ *
+ * @var relayResult::ultimateGain
+ * ultimate gain in output per tenth of a degree
+ * @var relayResult::ultimatePeriod
+ * ultimate period in control ticks
+ * @var relayResult::amplitude
+ * oscillation amplitude in tenths of a degree
+ */
+typedef struct {
+	float ultimateGain;
+	float ultimatePeriod;
+	float amplitude;
+} relayResult;
+
+/**
+ * @brief runs a relay experiment on one joint around where it is now
+ * @details the other joint is held by its PID. Blocks until the
+ * oscillation has been measured, the joint swings too far or it times out.
+ * @param joint 1 or 2
+ * @param result where to put the measurements
+ *
+ * @return TRUE if the oscillation was measured
+ */
+BOOL relayExperiment(int joint, relayResult *result);
+/**
+ * @brief tunes each joint the user asks for over the debug USART, then
+ * uses and saves the new gains
+ */
+void autotuneJoints();
+/**
+ * @brief uses the tuned gains saved in EEPROM, if there are any
+ *
+ * @return TRUE if saved gains were loaded
+ */
+BOOL loadTunedGains();
+
+#endif /* INCLUDE_AUTOTUNE_H_ */
@@ -0,0 +1,83 @@
+/** @brief joint pot calibration
+ *
+ * @file calibration.h
+ *
+ * Piecewise linear ADC to angle tables for the joint pots, built from a few
+ * poses recorded over the debug USART and kept in EEPROM. Angles are in
+ * tenths of a degree like the kinematics library.
+ *
+ * @author cpbove@wpi.edu
+ * @date 7-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_CALIBRATION_H_
+#define INCLUDE_CALIBRATION_H_
+
+#include "RBELib/RBELib.h"
+
+/**
+ * @def CAL_SHIFT
+ * the tables hold one angle every 2^CAL_SHIFT ADC counts
+ * @def CAL_STEP
+ * ADC counts between table entries
+ * @def CAL_TABLE_SIZE
+ * entries per joint, enough to cover 0 to 1024 counts
+ */
+#define CAL_SHIFT 2
+#define CAL_STEP (1 << CAL_SHIFT)
+#define CAL_TABLE_SIZE ((1024 >> CAL_SHIFT) + 1)
+
+/**
+ * @def CAL_MAGIC
+ * written to EEPROM once both tables are built, so stale EEPROM is ignored
+ * @def CAL_POSES
+ * most poses recorded per joint
+ * @def CAL_SAMPLES
+ * fresh ADC samples averaged at each pose
+ * @def CAL_MIN_COUNTS
+ * fewest ADC counts two poses of a joint have to be apart
+ */
+#define CAL_MAGIC 0xCA1B
+#define CAL_POSES 5
+#define CAL_SAMPLES 16
+#define CAL_MIN_COUNTS 8
+
+/**
+ * @def JOINT_1_CAL_ANGLES
+ * poses in degrees offered for joint 1
+ * @def JOINT_2_CAL_ANGLES
+ * poses in degrees offered for joint 2
+ */
+#define JOINT_1_CAL_ANGLES {0, 45, 90, 135, 180}
+#define JOINT_2_CAL_ANGLES {-90, -45, 0, 45, 90}
+
+/**
+ * @brief checks EEPROM for saved calibration tables
+ *
+ * @return TRUE if the tables are there and will be used
+ */
+BOOL loadJointCalibration();
+/**
+ * @brief checks if getJointAngleTenths is using the calibration tables
+ *
+ * @return TRUE if the tables were loaded or just built
+ */
+BOOL jointCalibrationLoaded();
+/**
+ * @brief looks an ADC reading up in a joint's calibration table
+ * @param joint 1 or 2
+ * @param adc joint pot reading, 0 to 1023
+ *
+ * @return angle of the joint in tenths of a degree
+ */
+int calibratedJointAngle(int joint, unsigned int adc);
+/**
+ * @brief records poses of both joints over the debug USART and rebuilds the
+ * EEPROM tables
+ * @details the motors are stopped so the arm can be moved by hand. Poses can
+ * be skipped, but each joint needs at least two.
+ */
+void calibrateJoints();
+
+#endif /* INCLUDE_CALIBRATION_H_ */
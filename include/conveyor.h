@@ -0,0 +1,133 @@
+/** @brief conveyor block tracker
+ *
+ * @file conveyor.h
+ *
+ * Follows blocks down the conveyor from the edges the two IR sensors see,
+ * timestamped by the ADC ISR, and predicts when each front will reach the
+ * arm. Blocks can't pass each other on the belt, so each edge belongs to
+ * the oldest block still waiting for it, and the tracker keeps following
+ * the blocks behind while the arm is busy with the first. Positions along
+ * the belt are in mm from the front IR sensor, times in seconds on the
+ * getTimeSeconds clock.
+ *
+ * @author cpbove@wpi.edu
+ * @date 13-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_CONVEYOR_H_
+#define INCLUDE_CONVEYOR_H_
+
+#include "RBELib/RBELib.h"
+
+/**
+ * @def CONVEYOR_EDGE_ON
+ * distance in mm a block has to come within for an IR sensor to see it
+ * @def CONVEYOR_EDGE_OFF
+ * distance in mm a block has to go past for an IR sensor to lose it again
+ */
+#define CONVEYOR_EDGE_ON 200
+#define CONVEYOR_EDGE_OFF 230
+
+/**
+ * @def CONVEYOR_MAX_BLOCKS
+ * blocks the tracker can follow at once
+ * @def CONVEYOR_MAX_EDGES
+ * edges one block can make, on and off each sensor
+ * @def CONVEYOR_BLOCK_TIMEOUT
+ * seconds a block can go without reaching the back sensor before the
+ * tracker gives up on it
+ * @def CONVEYOR_INTERCEPT_TOLERANCE
+ * standard deviation in seconds of the predicted intercept that counts as
+ * no confidence at all
+ */
+#define CONVEYOR_MAX_BLOCKS 3
+#define CONVEYOR_MAX_EDGES 4
+#define CONVEYOR_BLOCK_TIMEOUT 5
+#define CONVEYOR_INTERCEPT_TOLERANCE 0.1
+
+/**
+ * @struct conveyorEstimate
+ * what the tracker has worked out about a block on the belt
+ *
+ * @var conveyorEstimate::id
+ * sequence number of the block, each block the front sensor sees gets the
+ * next one
+ * @var conveyorEstimate::x
+ * x of the block in the arm frame in mm, once located
+ * @var conveyorEstimate::velocity
+ * speed of the block in mm/s
+ * @var conveyorEstimate::intercept
+ * getTimeSeconds time the front of the block reaches the arm
+ * @var conveyorEstimate::length
+ * length of the block along the belt in mm, 0 until a sensor has lost it
+ * @var conveyorEstimate::confidence
+ * 0 to 1, 1 less the standard deviation of the intercept over
+ * CONVEYOR_INTERCEPT_TOLERANCE
+ * @var conveyorEstimate::edges
+ * edges the estimate is fit to
+ * @var conveyorEstimate::located
+ * TRUE once the front sensor has found how far away the block is
+ * @var conveyorEstimate::fitted
+ * TRUE once both sensors have seen the block, so the velocity, intercept
+ * and confidence are set
+ */
+typedef struct {
+	unsigned int id;
+	int x;
+	float velocity;
+	float intercept;
+	float length;
+	float confidence;
+	unsigned char edges;
+	BOOL located;
+	BOOL fitted;
+} conveyorEstimate;
+
+/**
+ * @brief has the ADC ISR timestamp both IR sensors seeing and losing blocks
+ * @details the IR channels go in the ADC background, between the tick
+ * triggered sweeps, so they are sampled more often than the control tick
+ */
+void initConveyorTracker();
+/**
+ * @brief forgets every block so the next edges start a new one
+ */
+void resetConveyorTracker();
+/**
+ * @brief takes the edges the ADC ISR found and refits the blocks they
+ * belong to, and measures how far away the block in front of the front
+ * sensor is. Call every time through the main loop.
+ */
+void serviceConveyorTracker();
+/**
+ * @brief checks if there is a block on the belt
+ *
+ * @return TRUE while the tracker is following at least one block
+ */
+BOOL conveyorBlockSeen();
+/**
+ * @brief gets how many blocks the tracker is following
+ *
+ * @return blocks from the front sensor to the arm
+ */
+unsigned char conveyorBlockCount();
+/**
+ * @brief gets what the tracker knows about the oldest block on the belt
+ * @param estimate where to put it
+ *
+ * @return FALSE if there are no blocks
+ */
+BOOL getConveyorEstimate(conveyorEstimate *estimate);
+/**
+ * @brief stops following the oldest block, once it is picked or missed,
+ * so the next one becomes the oldest
+ */
+void dropConveyorBlock();
+/**
+ * @brief prints how many blocks the tracker followed, gave up on after
+ * CONVEYOR_BLOCK_TIMEOUT and had no room for
+ */
+void printConveyorStats();
+
+#endif /* INCLUDE_CONVEYOR_H_ */
@@ -37,6 +37,19 @@ int abs(int a);
  */
 BOOL betweenTwoVals(int value, int lower, int upper);
 
+/**
+ * @brief zeroes Timer1 and runs it at the CPU clock for counting cycles
+ * @note Timer1 isn't used by anything else, so benchmarks get it to themselves
+ */
+void startCycleCount();
+
+/**
+ * @brief gets the CPU cycles since startCycleCount
+ *
+ * @return cycles counted, 65535 if Timer1 overflowed
+ */
+unsigned int readCycleCount();
+
 #ifndef INCLUDE_DEFINITIONS_H_
 #define INCLUDE_DEFINITIONS_H_
 
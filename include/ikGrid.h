@@ -0,0 +1,47 @@
+/** @brief PROGMEM inverse kinematics grid
+ *
+ * @file ikGrid.h
+ *
+ * Generated by tools/ikGridGen.c with a 10 mm step, do not edit by hand.
+ */
+
+#ifndef INCLUDE_IKGRID_H_
+#define INCLUDE_IKGRID_H_
+
+#include <avr/pgmspace.h>
+
+/**
+ * @def IK_GRID_X_MIN
+ * x of the first grid column in mm
+ * @def IK_GRID_Y_MIN
+ * y of the first grid row in mm
+ * @def IK_GRID_STEP
+ * grid spacing in mm
+ * @def IK_GRID_COLS
+ * number of grid columns (x)
+ * @def IK_GRID_ROWS
+ * number of grid rows (y)
+ * @def IK_GRID_UNREACHABLE
+ * value of a grid point the arm can't reach
+ * @def IK_GRID_CELL_BYTES
+ * bytes per row of ikGridCellOK
+ */
+#define IK_GRID_X_MIN 100
+#define IK_GRID_Y_MIN 120
+#define IK_GRID_STEP 10
+#define IK_GRID_COLS 23
+#define IK_GRID_ROWS 15
+#define IK_GRID_UNREACHABLE 32767
+#define IK_GRID_CELL_BYTES 3
+
+/**
+ * @var ikGrid
+ * joint 1 and joint 2 angles in tenths of a degree at each grid point
+ *
+ * @var ikGridCellOK
+ * bit per cell, set if interpolating it stays within 0.25 degrees
+ */
+extern const int ikGrid[IK_GRID_ROWS][IK_GRID_COLS][2] PROGMEM;
+extern const unsigned char ikGridCellOK[IK_GRID_ROWS - 1][IK_GRID_CELL_BYTES] PROGMEM;
+
+#endif /* INCLUDE_IKGRID_H_ */
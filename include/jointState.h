@@ -0,0 +1,148 @@
+/** @brief joint state provider
+ *
+ * @file jointState.h
+ *
+ * Joint angles for the control loop. The joints start on their pots, and
+ * go on their encoders once calibrateEncoders has measured the counts per
+ * rev, which are kept in EEPROM for the next start. Once a joint is
+ * switched to its encoder, it is homed against the pot and its
+ * angle comes from the encoder count, which is read over SPI once per tick
+ * and doesn't use the ADC. The pots are still checked every tick to catch
+ * the encoders slipping. Angles are in tenths of a degree.
+ *
+ * @author cpbove@wpi.edu
+ * @date 8-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_JOINTSTATE_H_
+#define INCLUDE_JOINTSTATE_H_
+
+#include "RBELib/RBELib.h"
+
+/**
+ * @def JOINT_ENC_MAGIC
+ * written to EEPROM with the measured counts per rev, so stale EEPROM is
+ * ignored
+ * @def JOINT_ENC_CAL_TENTHS
+ * how far in tenths of a degree a joint has to be moved between the two
+ * readings calibrateEncoders takes, further keeps the pot error smaller
+ * @def JOINT_ENC_CAL_MIN_COUNTS
+ * encoder counts a joint has to move by for the measurement to count, so a
+ * dead encoder isn't taken as a very coarse one
+ * @def JOINT_ENC_CAL_SAMPLES
+ * pot samples averaged for each reading calibrateEncoders takes
+ */
+#define JOINT_ENC_MAGIC 0xE4C0
+#define JOINT_ENC_CAL_TENTHS 450
+#define JOINT_ENC_CAL_MIN_COUNTS 50
+#define JOINT_ENC_CAL_SAMPLES 16
+
+/**
+ * @def JOINT_SLIP_TENTHS
+ * how far in tenths of a degree the encoder angle can be from the pot before
+ * it counts as slipping
+ * @def JOINT_SLIP_MS
+ * how long in ms the encoder has to be off before it is re-homed
+ * @def JOINT_MAX_SLIPS
+ * slips after which a joint gives up on its encoder and uses the pot
+ */
+#define JOINT_SLIP_TENTHS 50
+#define JOINT_SLIP_MS 100
+#define JOINT_MAX_SLIPS 5
+
+/**
+ * @enum jointFeedback
+ * where a joint's angle comes from
+ * @var JOINT_FEEDBACK_POT
+ * the calibrated pot
+ * @var JOINT_FEEDBACK_ENCODER
+ * the encoder, homed against the pot
+ */
+enum jointFeedback {
+	JOINT_FEEDBACK_POT,
+	JOINT_FEEDBACK_ENCODER
+};
+
+/**
+ * @brief sets the encoders up and takes the joint angles from the pots
+ * @details waits for a sweep of the pots first, so the angles aren't from
+ * before the ADC trigger was set. If calibrateEncoders has saved counts per
+ * rev, the joints are then homed and put on their encoders.
+ * @note SPI and the ADC have to be running
+ */
+void initJointState();
+/**
+ * @brief averages fresh pot angles of a joint
+ * @param joint 1 or 2
+ *
+ * @return average of JOINT_ENC_CAL_SAMPLES angles, in tenths of a degree
+ */
+int averageJointTenths(int joint);
+/**
+ * @brief measures one joint's encoder counts per rev against its pot
+ * @details the joint is moved by hand between two readings, at least
+ * JOINT_ENC_CAL_TENTHS apart
+ * @param joint 1 or 2
+ *
+ * @return counts per rev, negative if the encoder counts down as the angle
+ * goes up, 0 if the joint wasn't moved far enough or the encoder didn't count
+ */
+long measureCountsPerRev(int joint);
+/**
+ * @brief measures both encoders' counts per rev against the pots over the
+ * debug USART, saves them in EEPROM and puts the joints on their encoders
+ * @details the motors are stopped so the arm can be moved by hand. Use
+ * calibrateJoints first, the counts are only as good as the pot angles.
+ */
+void calibrateEncoders();
+/**
+ * @brief zeroes a joint's encoder and takes its angle from the pot
+ * @param joint 1 or 2
+ */
+void homeJoint(int joint);
+/**
+ * @brief reads the encoders and checks them against the pots
+ * @details call once per control tick, before the angles are used
+ */
+void updateJointState();
+/**
+ * @brief gets a joint's angle from the last updateJointState
+ * @param joint 1 or 2
+ *
+ * @return angle of the joint in tenths of a degree
+ */
+int getJointTenths(int joint);
+/**
+ * @brief gets where a joint's angle is coming from
+ * @param joint 1 or 2
+ *
+ * @return one of the jointFeedback values
+ */
+unsigned char getJointFeedback(int joint);
+/**
+ * @brief picks where a joint's angle comes from
+ * @details switching to the encoder re-homes it and clears the slip count.
+ * A joint whose encoder hasn't been measured stays on its pot.
+ * @param joint 1 or 2
+ * @param feedback one of the jointFeedback values
+ */
+void setJointFeedback(int joint, unsigned char feedback);
+/**
+ * @brief gets how many times a joint's encoder slipped
+ * @param joint 1 or 2
+ *
+ * @return slips since initJointState
+ */
+unsigned int getJointSlipCount(int joint);
+/**
+ * @brief prints any encoder slips since the last call over the debug USART
+ * @details call from the main loop, not the control tick
+ */
+void reportJointSlips();
+/**
+ * @brief prints the pot and encoder angles of each joint over the debug USART
+ */
+void printJointState();
+
+#endif /* INCLUDE_JOINTSTATE_H_ */
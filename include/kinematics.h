@@ -0,0 +1,158 @@
+/** @brief fixed point kinematics library
+ *
+ * @file kinematics.h
+ *
+ * Integer versions of the arm kinematics so they can run every control
+ * tick. Angles are in tenths of a degree, positions in tenths of a mm and
+ * sines and cosines in Q15 (32767 = 1.0).
+ *
+ * @author cpbove@wpi.edu
+ * @date 5-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_KINEMATICS_H_
+#define INCLUDE_KINEMATICS_H_
+
+#include "RBELib/RBELib.h"
+
+/**
+ * @def Q15_ONE
+ * 1.0 in Q15
+ * @def TENTHS_PER_DEGREE
+ * fixed point angles are in tenths of a degree
+ * @def TENTHS_PER_MM
+ * fixed point positions are in tenths of a mm
+ */
+#define Q15_ONE 32767
+#define TENTHS_PER_DEGREE 10
+#define TENTHS_PER_MM 10
+
+/**
+ * @brief looks up the sine of an angle
+ * @param angle angle in tenths of a degree, any range
+ *
+ * @return sine of the angle in Q15
+ */
+int sinTenths(int angle);
+/**
+ * @brief looks up the cosine of an angle
+ * @param angle angle in tenths of a degree, any range
+ *
+ * @return cosine of the angle in Q15
+ */
+int cosTenths(int angle);
+/**
+ * @brief fixed point forward kinematics for the end of link 3
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ * @param x where to put x in tenths of a mm
+ * @param y where to put y in tenths of a mm
+ */
+void forwardKinematics(int theta1, int theta2, int *x, int *y);
+/**
+ * @brief floating point forward kinematics, the reference calcXY uses
+ * @param theta1 joint 1 angle in degrees
+ * @param theta2 joint 2 angle in degrees
+ * @param x where to put x in mm
+ * @param y where to put y in mm
+ */
+void forwardKinematicsFloat(float theta1, float theta2, float *x, float *y);
+/**
+ * @brief fixed point atan2 by CORDIC
+ * @param y y component, any scale
+ * @param x x component, same scale as y
+ *
+ * @return angle of (x,y) in tenths of a degree, -1800 to 1800
+ */
+int atan2Tenths(long y, long x);
+/**
+ * @brief integer square root
+ * @param value number to take the root of
+ *
+ * @return floor of the square root
+ */
+unsigned int isqrt32(unsigned long value);
+/**
+ * @brief fixed point inverse kinematics, elbow up like setPosition
+ * @param x desired x in tenths of a mm
+ * @param y desired y in tenths of a mm
+ * @param theta1 where to put joint 1 in tenths of a degree
+ * @param theta2 where to put joint 2 in tenths of a degree
+ *
+ * @return FALSE if the point is out of reach (angles are left alone)
+ */
+BOOL inverseKinematics(int x, int y, int *theta1, int *theta2);
+/**
+ * @brief turns a small end effector move into joint moves with the inverse
+ * Jacobian at the given angles
+ * @details the determinant is -L2 L3 cos(theta2), so it goes singular with
+ * the arm straight (theta2 = 90). Moves bigger than JACOBIAN_MAX_STEP are
+ * clamped.
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ * @param dx x move in tenths of a mm
+ * @param dy y move in tenths of a mm
+ * @param dTheta1 where to put the joint 1 move in tenths of a degree
+ * @param dTheta2 where to put the joint 2 move in tenths of a degree
+ *
+ * @return FALSE if the arm is too close to straight to invert the Jacobian
+ */
+BOOL jacobianStep(int theta1, int theta2, int dx, int dy, int *dTheta1, int *dTheta2);
+/**
+ * @brief inverse kinematics by Newton's method, warm started from the angles
+ * passed in
+ * @details each iteration is a fixed point FK and a Jacobian step on the
+ * error, so a point close to the last one converges in one or two. Far
+ * points and points near the straight arm singularity fail, and the angles
+ * are left alone for the analytic IK to take over.
+ * @param x desired x in tenths of a mm
+ * @param y desired y in tenths of a mm
+ * @param theta1 joint 1 angle to start from, and where to put the answer, in
+ * tenths of a degree
+ * @param theta2 joint 2 angle to start from, and where to put the answer, in
+ * tenths of a degree
+ *
+ * @return FALSE if it didn't converge
+ */
+BOOL incrementalIK(int x, int y, int *theta1, int *theta2);
+/**
+ * @brief inverse kinematics by bilinear interpolation of the PROGMEM grid
+ * @details only covers the conveyor workspace, and skips cells near the
+ * edge of reach where interpolation isn't accurate enough (see ikGridGen)
+ * @param x desired x in tenths of a mm
+ * @param y desired y in tenths of a mm
+ * @param theta1 where to put joint 1 in tenths of a degree
+ * @param theta2 where to put joint 2 in tenths of a degree
+ *
+ * @return FALSE if the point isn't covered by a usable grid cell
+ */
+BOOL inverseKinematicsGrid(int x, int y, int *theta1, int *theta2);
+/**
+ * @brief floating point inverse kinematics, the old setPosition math
+ * @param x desired x in mm
+ * @param y desired y in mm
+ * @param theta1 where to put joint 1 in degrees
+ * @param theta2 where to put joint 2 in degrees
+ */
+void inverseKinematicsFloat(float x, float y, float *theta1, float *theta2);
+/**
+ * @brief rounds a fixed point angle to the nearest whole degree
+ * @param angle angle in tenths of a degree
+ *
+ * @return angle in degrees
+ */
+int tenthsToDegrees(int angle);
+/**
+ * @brief sweeps the workspace and prints the worst difference between
+ * inverseKinematics, inverseKinematicsGrid and inverseKinematicsFloat, and
+ * the cycles each takes
+ */
+void printIKAccuracy();
+/**
+ * @brief sweeps the joint range and prints the worst and RMS difference
+ * between forwardKinematics and forwardKinematicsFloat
+ */
+void printFKAccuracy();
+
+#endif /* INCLUDE_KINEMATICS_H_ */
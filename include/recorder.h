@@ -0,0 +1,120 @@
+/** @brief joint motion recorder
+ *
+ * @file recorder.h
+ *
+ * Records the joint angles every few control ticks, delta encoded so most
+ * samples take one byte, and plays them back at the timing they were
+ * recorded with. Recordings can spill into EEPROM, which makes them longer
+ * and keeps them over a reset. Angles are in tenths of a degree like the
+ * kinematics library.
+ *
+ * @author cpbove@wpi.edu
+ * @date 12-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_RECORDER_H_
+#define INCLUDE_RECORDER_H_
+
+#include "RBELib/RBELib.h"
+#include "include/PID.h"
+
+/**
+ * @def RECORD_BUFFER_SIZE
+ * bytes of SRAM a recording is written into, a power of 2
+ * @def RECORD_EEPROM_SIZE
+ * bytes of EEPROM a recording can spill into
+ * @def RECORD_PERIOD
+ * control ticks between samples drawTriangleWithButtons records at
+ */
+#define RECORD_BUFFER_SIZE 512
+#define RECORD_EEPROM_SIZE 768
+#define RECORD_PERIOD 2
+
+/**
+ * @def RECORD_MAGIC
+ * written to EEPROM with a fully spilled recording, so stale EEPROM is ignored
+ * @def RECORD_ESCAPE
+ * high nibble of a byte that isn't two packed deltas, the low nibble says
+ * what follows
+ * @def RECORD_BYTE_DELTAS
+ * escape for two signed byte deltas
+ * @def RECORD_ABSOLUTE
+ * escape for two whole angles, low byte first
+ * @def RECORD_GAP
+ * escape for a byte of extra ticks before the next sample
+ * @def RECORD_MAX_SAMPLE
+ * most bytes one sample can take, with a gap in front of it
+ */
+#define RECORD_MAGIC 0x5EC0
+#define RECORD_ESCAPE 0x80
+#define RECORD_BYTE_DELTAS 0x80
+#define RECORD_ABSOLUTE 0x81
+#define RECORD_GAP 0x82
+#define RECORD_MAX_SAMPLE 7
+
+/**
+ * @enum playbackStates
+ * what a playback is doing
+ */
+enum playbackStates {
+	PLAYBACK_IDLE,
+	PLAYBACK_APPROACH,
+	PLAYBACK_RUN
+};
+
+/**
+ * @brief starts a new recording of the joint angles
+ * @param period control ticks between samples
+ * @param spill TRUE to drain the recording into EEPROM while it runs
+ */
+void startRecording(unsigned char period, BOOL spill);
+/**
+ * @brief stops recording, anything waiting still drains into EEPROM
+ */
+void stopRecording();
+/**
+ * @brief checks if a recording is running
+ *
+ * @return TRUE until stopRecording or the storage fills
+ */
+BOOL recording();
+/**
+ * @brief takes a sample when one is due and moves a byte into EEPROM if
+ * it's free. Call every control tick.
+ */
+void serviceRecorder();
+/**
+ * @brief loads the recording saved in EEPROM, if there is one
+ *
+ * @return TRUE if a saved recording was found
+ */
+BOOL loadRecording();
+/**
+ * @brief moves the arm to the start of the recording, then plays it back
+ * at the timing it was recorded with
+ *
+ * @return FALSE if there is nothing to play
+ */
+BOOL startPlayback();
+/**
+ * @brief stops a playback, the arm holds where it is
+ */
+void stopPlayback();
+/**
+ * @brief checks if a playback is running
+ *
+ * @return TRUE while moving to the start or playing
+ */
+BOOL playingBack();
+/**
+ * @brief drives the arm to this tick's setpoints of the playback. Call every
+ * control tick while playingBack.
+ */
+void servicePlayback();
+/**
+ * @brief prints how long the recording is and how it's stored
+ */
+void printRecording();
+
+#endif /* INCLUDE_RECORDER_H_ */
@@ -0,0 +1,170 @@
+/** @brief joint space trajectories
+ *
+ * @file trajectory.h
+ *
+ * Minimum jerk (quintic) or trapezoidal velocity moves between two sets of
+ * joint angles. Both joints share one duration, the shortest that keeps each
+ * inside its velocity and acceleration limits. The profiles are worked out
+ * once per move, then each control tick is a few integer multiplies. Angles
+ * are in tenths of a degree like the kinematics library.
+ *
+ * @author cpbove@wpi.edu
+ * @date 11-Mar-2016
+ * @version 1.0
+ */
+
+#ifndef INCLUDE_TRAJECTORY_H_
+#define INCLUDE_TRAJECTORY_H_
+
+#include "RBELib/RBELib.h"
+#include "include/PID.h"
+
+/**
+ * @def TRAJ_JOINT_1_MAX_VELOCITY
+ * fastest joint 1 is planned to move in tenths of a degree per second
+ * @def TRAJ_JOINT_1_MAX_ACCEL
+ * hardest joint 1 is planned to accelerate in tenths of a degree per second^2
+ * @def TRAJ_JOINT_2_MAX_VELOCITY
+ * fastest joint 2 is planned to move in tenths of a degree per second
+ * @def TRAJ_JOINT_2_MAX_ACCEL
+ * hardest joint 2 is planned to accelerate in tenths of a degree per second^2
+ */
+#define TRAJ_JOINT_1_MAX_VELOCITY 1500
+#define TRAJ_JOINT_1_MAX_ACCEL 7000
+#define TRAJ_JOINT_2_MAX_VELOCITY 1800
+#define TRAJ_JOINT_2_MAX_ACCEL 9000
+
+/**
+ * @def TRAJ_TAU_SHIFT
+ * fraction bits in the normalized time the minimum jerk shapes are run on
+ */
+#define TRAJ_TAU_SHIFT 14
+
+/**
+ * @def TRAJ_VELOCITY_SHIFT
+ * fraction bits in the trapezoid cruise rates, tenths of a degree per tick
+ */
+#define TRAJ_VELOCITY_SHIFT 16
+
+/**
+ * @enum trajectoryProfiles
+ * shape of a planned move, TRAJ_STEP jumps straight to the end
+ */
+enum trajectoryProfiles {
+	TRAJ_MIN_JERK,
+	TRAJ_TRAPEZOID,
+	TRAJ_STEP
+};
+
+/**
+ * @struct quinticJoint
+ * how one joint's minimum jerk move scales the shapes in normalized time
+ *
+ * @var quinticJoint::distance
+ * how far the joint moves in tenths of a degree
+ * @var quinticJoint::velocity
+ * 30 distance / duration, tenths of a degree per second
+ * @var quinticJoint::acceleration
+ * 60 distance / duration^2, tenths of a degree per second^2
+ */
+typedef struct {
+	int distance;
+	long velocity;
+	long acceleration;
+} quinticJoint;
+
+/**
+ * @struct trapezoidJoint
+ * one joint's trapezoidal velocity profile: accelerate, cruise, then
+ * decelerate over the same number of ticks
+ *
+ * @var trapezoidJoint::accelTicks
+ * ticks spent speeding up, and again slowing down
+ * @var trapezoidJoint::cruise
+ * cruise rate in tenths of a degree per tick with TRAJ_VELOCITY_SHIFT
+ * fraction bits, negative for moves down
+ * @var trapezoidJoint::cruiseRate
+ * cruise rate in tenths of a degree per second
+ * @var trapezoidJoint::accelRate
+ * acceleration while speeding up in tenths of a degree per second^2
+ */
+typedef struct {
+	unsigned int accelTicks;
+	long cruise;
+	int cruiseRate;
+	int accelRate;
+} trapezoidJoint;
+
+/**
+ * @struct jointTrajectory
+ * a planned move of both joints
+ *
+ * @var jointTrajectory::profile
+ * TRAJ_MIN_JERK or TRAJ_TRAPEZOID
+ * @var jointTrajectory::start
+ * angle of each joint at the start of the move, joint 1 first
+ * @var jointTrajectory::end
+ * angle of each joint at the end of the move
+ * @var jointTrajectory::quintic
+ * scales for each joint of a minimum jerk move
+ * @var jointTrajectory::trapezoid
+ * velocity profile for each joint of a trapezoidal move
+ * @var jointTrajectory::duration
+ * length of the move in control ticks
+ * @var jointTrajectory::tick
+ * ticks of the move done so far
+ * @var jointTrajectory::active
+ * TRUE until the last tick of the move has been given out
+ */
+typedef struct {
+	unsigned char profile;
+	int start[PID_NUM_JOINTS];
+	int end[PID_NUM_JOINTS];
+	quinticJoint quintic[PID_NUM_JOINTS];
+	trapezoidJoint trapezoid[PID_NUM_JOINTS];
+	unsigned int duration;
+	unsigned int tick;
+	BOOL active;
+} jointTrajectory;
+
+/**
+ * @brief plans a minimum jerk move of both joints
+ * @details the duration is the shortest that keeps every joint inside its
+ * velocity and acceleration limits, at the current control rate
+ * @param traj trajectory to plan, it starts at its first tick
+ * @param start angle of each joint now, joint 1 first
+ * @param end angle of each joint at the end of the move
+ *
+ * @return length of the move in control ticks
+ */
+unsigned int planTrajectory(jointTrajectory *traj, const int *start, const int *end);
+/**
+ * @brief plans the fastest trapezoidal move of both joints that ends with
+ * both together
+ * @details the slowest joint sets the duration, flat out on its limits. The
+ * others keep their acceleration limit and cruise just fast enough to
+ * finish at the same time.
+ * @param traj trajectory to plan, it starts at its first tick
+ * @param start angle of each joint now, joint 1 first
+ * @param end angle of each joint at the end of the move
+ *
+ * @return length of the move in control ticks
+ */
+unsigned int planTrapezoid(jointTrajectory *traj, const int *start, const int *end);
+/**
+ * @brief gets the setpoints for this tick and moves the trajectory on one
+ * @param traj trajectory to step
+ * @param targets where to put each joint's angle, velocity and acceleration
+ *
+ * @return FALSE once the move is over, the targets then hold the end angles
+ */
+BOOL stepTrajectory(jointTrajectory *traj, jointTarget *targets);
+/**
+ * @brief gets how much of a move is left
+ * @param traj trajectory to check
+ *
+ * @return control ticks until the move ends, 0 if it is over
+ */
+unsigned int trajectoryTicksLeft(const jointTrajectory *traj);
+
+#endif /* INCLUDE_TRAJECTORY_H_ */
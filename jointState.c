@@ -0,0 +1,335 @@
+/** @brief joint state provider
+ *
+ * @file jointState.c
+ *
+ * Joint angles for the control loop. The joints start on their pots, and
+ * go on their encoders once calibrateEncoders has measured the counts per
+ * rev, which are kept in EEPROM for the next start. Once a joint is
+ * switched to its encoder, it is homed against the pot and its
+ * angle comes from the encoder count, which is read over SPI once per tick
+ * and doesn't use the ADC. The pots are still checked every tick, and an
+ * encoder that stays too far from its pot is re-homed and counted as a
+ * slip. A joint that keeps slipping goes back to its pot.
+ *
+ * @author cpbove@wpi.edu
+ * @date 8-Mar-2016
+ * @version 1.0
+ */
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h"
+#include "include/arm.h"
+#include "include/ADC.h"
+#include "include/kinematics.h"
+#include "include/jointState.h"
+#include <avr/eeprom.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @var encMagic
+ * JOINT_ENC_MAGIC once measured counts per rev have been written
+ *
+ * @var encCountsPerRev
+ * measured encoder counts per revolution of each joint
+ */
+uint16_t EEMEM encMagic;
+uint32_t EEMEM encCountsPerRev[2];
+
+/**
+ * @var jointTenths
+ * angle of each joint from the last updateJointState
+ * @var potTenths
+ * pot angle of each joint from the last updateJointState
+ * @var encoderOffset
+ * angle of each joint when its encoder was zeroed
+ * @var countsPerRev
+ * encoder counts per revolution of each joint, negative if it counts down
+ * as the angle goes up. 0 until calibrateEncoders has measured it.
+ */
+int jointTenths[2];
+int potTenths[2];
+int encoderOffset[2];
+long countsPerRev[2];
+
+/**
+ * @var feedbackSource
+ * jointFeedback value for each joint
+ * @var slipTicks
+ * ticks in a row each encoder has been off from its pot
+ * @var slipCount
+ * times each encoder has been re-homed for slipping
+ * @var slipEncoderTenths
+ * encoder angle of each joint when it last slipped
+ * @var slipPotTenths
+ * pot angle of each joint when it last slipped
+ * @var slipsUnreported
+ * slips of each joint since reportJointSlips last printed them
+ */
+unsigned char feedbackSource[2];
+unsigned char slipTicks[2];
+unsigned int slipCount[2];
+int slipEncoderTenths[2];
+int slipPotTenths[2];
+unsigned char slipsUnreported[2];
+
+/**
+ * @brief turns an encoder count into a joint angle
+ * @param joint 1 or 2
+ * @param count encoder count since it was zeroed
+ *
+ * @return angle of the joint in tenths of a degree
+ */
+int encoderTenths(int joint, long count){
+	unsigned char i = (joint == 1) ? 0 : 1;
+	return encoderOffset[i] + count * 3600 / countsPerRev[i];
+}
+
+/**
+ * @brief sets the encoders up and takes the joint angles from the pots
+ * @details waits for a sweep of the pots first, so the angles aren't from
+ * before the ADC trigger was set. If calibrateEncoders has saved counts per
+ * rev, the joints are then homed and put on their encoders.
+ * @note SPI and the ADC have to be running
+ */
+void initJointState(){
+	int joint;
+	// throw away the sweep in progress, then wait for one with both pots
+	adcSweepReady();
+	while(!adcSweepReady() || !adcChannelReady(JOINT_1_ADC) || !adcChannelReady(JOINT_2_ADC))
+		;
+	for(joint = 1; joint <= 2; joint++){
+		encInit(joint);
+		setJointFeedback(joint, JOINT_FEEDBACK_POT);
+	}
+	if(eeprom_read_word(&encMagic) == JOINT_ENC_MAGIC){
+		for(joint = 1; joint <= 2; joint++){
+			countsPerRev[joint - 1] = (int32_t)eeprom_read_dword(&encCountsPerRev[joint - 1]);
+			setJointFeedback(joint, JOINT_FEEDBACK_ENCODER);
+		}
+	}
+	updateJointState();
+}
+
+/**
+ * @brief averages fresh pot angles of a joint
+ * @param joint 1 or 2
+ *
+ * @return average of JOINT_ENC_CAL_SAMPLES angles, in tenths of a degree
+ */
+int averageJointTenths(int joint){
+	adcSample sample;
+	long total = 0;
+	unsigned char samples = 0;
+	getADCSample(joint == 1 ? JOINT_1_ADC : JOINT_2_ADC, &sample);
+	unsigned long lastCount = sample.count;
+	// only count each sample the scanner publishes once
+	while(samples < JOINT_ENC_CAL_SAMPLES){
+		getADCSample(joint == 1 ? JOINT_1_ADC : JOINT_2_ADC, &sample);
+		if(sample.count != lastCount){
+			lastCount = sample.count;
+			total += getJointAngleTenths(joint);
+			samples++;
+		}
+	}
+	return total / JOINT_ENC_CAL_SAMPLES;
+}
+
+/**
+ * @brief measures one joint's encoder counts per rev against its pot
+ * @details the joint is moved by hand between two readings, at least
+ * JOINT_ENC_CAL_TENTHS apart
+ * @param joint 1 or 2
+ *
+ * @return counts per rev, negative if the encoder counts down as the angle
+ * goes up, 0 if the joint wasn't moved far enough or the encoder didn't count
+ */
+long measureCountsPerRev(int joint){
+	int startTenths, endTenths;
+	long startCount, endCount;
+	char c;
+
+	printf("Move joint %d to one end of its travel, then send y (or n to cancel)\n\r", joint);
+	do {
+		c = getCharDebug();
+	} while(c != 'y' && c != 'n');
+	if(c == 'n')
+		return 0;
+	startTenths = averageJointTenths(joint);
+	startCount = encCount(joint);
+
+	printf("Move joint %d at least %d degrees, then send y\n\r", joint,
+			JOINT_ENC_CAL_TENTHS / TENTHS_PER_DEGREE);
+	do {
+		c = getCharDebug();
+	} while(c != 'y');
+	endTenths = averageJointTenths(joint);
+	endCount = encCount(joint);
+
+	printf("%d to %d tenths, %ld counts\n\r", startTenths, endTenths, endCount - startCount);
+	if(abs(endTenths - startTenths) >= JOINT_ENC_CAL_TENTHS
+			&& labs(endCount - startCount) >= JOINT_ENC_CAL_MIN_COUNTS)
+		return (endCount - startCount) * 3600 / (endTenths - startTenths);
+	printf("Joint %d didn't move far enough, or its encoder isn't counting\n\r", joint);
+	return 0;
+}
+
+/**
+ * @brief measures both encoders' counts per rev against the pots over the
+ * debug USART, saves them in EEPROM and puts the joints on their encoders
+ * @details the motors are stopped so the arm can be moved by hand. Use
+ * calibrateJoints first, the counts are only as good as the pot angles.
+ */
+void calibrateEncoders(){
+	long counts[2];
+	int joint;
+
+	stopMotors();
+	printf("Measuring the encoders, motors are off\n\r");
+	for(joint = 1; joint <= 2; joint++){
+		counts[joint - 1] = measureCountsPerRev(joint);
+		if(!counts[joint - 1]){
+			printf("Encoders not saved, the joints stay on their pots\n\r");
+			return;
+		}
+		printf("Joint %d: %ld counts per rev\n\r", joint, counts[joint - 1]);
+	}
+
+	// invalidate the old counts while the new ones are written
+	eeprom_update_word(&encMagic, 0);
+	for(joint = 1; joint <= 2; joint++){
+		eeprom_update_dword(&encCountsPerRev[joint - 1], counts[joint - 1]);
+		countsPerRev[joint - 1] = counts[joint - 1];
+		setJointFeedback(joint, JOINT_FEEDBACK_ENCODER);
+	}
+	eeprom_update_word(&encMagic, JOINT_ENC_MAGIC);
+	printf("Encoders saved, the joints are on their encoders\n\r");
+}
+
+/**
+ * @brief zeroes a joint's encoder and takes its angle from the pot
+ * @param joint 1 or 2
+ */
+void homeJoint(int joint){
+	int angle = getJointAngleTenths(joint);
+	resetEncCount(joint);
+	encoderOffset[joint - 1] = angle;
+	potTenths[joint - 1] = angle;
+	jointTenths[joint - 1] = angle;
+	slipTicks[joint - 1] = 0;
+}
+
+/**
+ * @brief reads the encoders and checks them against the pots
+ * @details call once per control tick, before the angles are used
+ */
+void updateJointState(){
+	int joint;
+	for(joint = 1; joint <= 2; joint++){
+		unsigned char i = joint - 1;
+		potTenths[i] = getJointAngleTenths(joint); // scanner snapshot, no waiting
+		if(feedbackSource[i] == JOINT_FEEDBACK_POT){
+			jointTenths[i] = potTenths[i];
+			continue;
+		}
+
+		jointTenths[i] = encoderTenths(joint, encCount(joint));
+		// the pot is noisy, so only call it a slip if it stays off
+		if(betweenTwoVals(jointTenths[i] - potTenths[i], -JOINT_SLIP_TENTHS, JOINT_SLIP_TENTHS))
+			slipTicks[i] = 0;
+		else if(++slipTicks[i] >= JOINT_SLIP_MS * (long)controlTicksPerSec / 1000){
+			// no printing in the control tick, reportJointSlips does that
+			slipCount[i]++;
+			slipEncoderTenths[i] = jointTenths[i];
+			slipPotTenths[i] = potTenths[i];
+			slipsUnreported[i]++;
+			if(slipCount[i] >= JOINT_MAX_SLIPS){
+				feedbackSource[i] = JOINT_FEEDBACK_POT;
+				jointTenths[i] = potTenths[i];
+			}
+			else
+				homeJoint(joint);
+		}
+	}
+}
+
+/**
+ * @brief gets a joint's angle from the last updateJointState
+ * @param joint 1 or 2
+ *
+ * @return angle of the joint in tenths of a degree
+ */
+int getJointTenths(int joint){
+	return jointTenths[joint == 1 ? 0 : 1];
+}
+
+/**
+ * @brief gets where a joint's angle is coming from
+ * @param joint 1 or 2
+ *
+ * @return one of the jointFeedback values
+ */
+unsigned char getJointFeedback(int joint){
+	return feedbackSource[joint == 1 ? 0 : 1];
+}
+
+/**
+ * @brief picks where a joint's angle comes from
+ * @details switching to the encoder re-homes it and clears the slip count.
+ * A joint whose encoder hasn't been measured stays on its pot.
+ * @param joint 1 or 2
+ * @param feedback one of the jointFeedback values
+ */
+void setJointFeedback(int joint, unsigned char feedback){
+	unsigned char i = (joint == 1) ? 0 : 1;
+	if(feedback == JOINT_FEEDBACK_ENCODER && !countsPerRev[i])
+		feedback = JOINT_FEEDBACK_POT;
+	feedbackSource[i] = feedback;
+	if(feedback == JOINT_FEEDBACK_ENCODER){
+		slipCount[i] = 0;
+		homeJoint(i + 1);
+	}
+}
+
+/**
+ * @brief gets how many times a joint's encoder slipped
+ * @param joint 1 or 2
+ *
+ * @return slips since initJointState
+ */
+unsigned int getJointSlipCount(int joint){
+	return slipCount[joint == 1 ? 0 : 1];
+}
+
+/**
+ * @brief prints any encoder slips since the last call over the debug USART
+ * @details call from the main loop, not the control tick
+ */
+void reportJointSlips(){
+	int joint;
+	for(joint = 1; joint <= 2; joint++){
+		unsigned char i = joint - 1;
+		if(!slipsUnreported[i])
+			continue;
+		printf("Joint %d encoder slipped %u times (last %d vs pot %d)\n\r", joint,
+				slipsUnreported[i], slipEncoderTenths[i], slipPotTenths[i]);
+		slipsUnreported[i] = 0;
+		if(feedbackSource[i] == JOINT_FEEDBACK_POT)
+			printf("Joint %d back on its pot\n\r", joint);
+	}
+}
+
+/**
+ * @brief prints the pot and encoder angles of each joint over the debug USART
+ */
+void printJointState(){
+	int joint;
+	reportJointSlips();
+	printf("Joint,Source,Angle,Pot,Encoder count,Counts per rev,Slips\n\r");
+	for(joint = 1; joint <= 2; joint++){
+		unsigned char i = joint - 1;
+		printf("%d,%s,%d,%d,%ld,%ld,%u\n\r", joint,
+				feedbackSource[i] == JOINT_FEEDBACK_ENCODER ? "encoder" : "pot",
+				jointTenths[i], potTenths[i], encCount(joint), countsPerRev[i], slipCount[i]);
+	}
+}
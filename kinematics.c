@@ -0,0 +1,574 @@
+/** @brief fixed point kinematics library
+ *
+ * @file kinematics.c
+ *
+ * Integer versions of the arm kinematics so they can run every control
+ * tick. Sines come from a quarter wave table in flash with linear
+ * interpolation between whole degrees. Inverse kinematics uses CORDIC for
+ * atan2 and keeps the law of cosines in integers scaled by 2 L2 L3, so it
+ * never has to divide.
+ *
+ * @author cpbove@wpi.edu
+ * @date 5-Mar-2016
+ * @version 1.0
+ */
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h"
+#include "include/arm.h"
+#include "include/kinematics.h"
+#include "include/ikGrid.h"
+#include <avr/pgmspace.h>
+#include "math.h"
+
+/**
+ * @def LINK_1_Q4
+ * length of Link 1 in tenths of a mm, Q4
+ * @def LINK_2_Q4
+ * length of Link 2 in tenths of a mm, Q4
+ * @def LINK_3_Q4
+ * length of Link 3 in tenths of a mm, Q4
+ */
+#define LINK_1_Q4 ((long)(LINK_1_Length * TENTHS_PER_MM * 16 + 0.5))
+#define LINK_2_Q4 ((long)(LINK_2_Length * TENTHS_PER_MM * 16 + 0.5))
+#define LINK_3_Q4 ((long)(LINK_3_Length * TENTHS_PER_MM * 16 + 0.5))
+
+/**
+ * @def LINK_1_TENTHS
+ * length of Link 1 in tenths of a mm
+ * @def LINKS_SQUARED
+ * L2^2 + L3^2 in tenths of a mm squared
+ * @def LINK_SUM_SQUARED
+ * (L2 + L3)^2 in tenths of a mm squared, the farthest reach
+ * @def LINK_DIFF_SQUARED
+ * (L2 - L3)^2 in tenths of a mm squared, the closest reach
+ * @def TWO_LINK_2_SQUARED
+ * 2 L2^2 in tenths of a mm squared
+ */
+#define LINK_1_TENTHS ((long)(LINK_1_Length * TENTHS_PER_MM + 0.5))
+#define LINKS_SQUARED ((long)((LINK_2_Length * LINK_2_Length + LINK_3_Length * LINK_3_Length) \
+		* TENTHS_PER_MM * TENTHS_PER_MM + 0.5))
+#define LINK_SUM_SQUARED ((long)((LINK_2_Length + LINK_3_Length) * (LINK_2_Length + LINK_3_Length) \
+		* TENTHS_PER_MM * TENTHS_PER_MM + 0.5))
+#define LINK_DIFF_SQUARED ((long)((LINK_2_Length - LINK_3_Length) * (LINK_2_Length - LINK_3_Length) \
+		* TENTHS_PER_MM * TENTHS_PER_MM + 0.5))
+#define TWO_LINK_2_SQUARED ((long)(2 * LINK_2_Length * LINK_2_Length \
+		* TENTHS_PER_MM * TENTHS_PER_MM + 0.5))
+
+/**
+ * @def LINK_2_TENTHS
+ * length of Link 2 in tenths of a mm
+ * @def LINK_3_TENTHS
+ * length of Link 3 in tenths of a mm
+ * @def RAD_TO_TENTHS
+ * tenths of a degree per radian
+ * @def JACOBIAN_MIN_COS
+ * smallest cos of joint 2 (Q15) the Jacobian is inverted at, cos(80)
+ * @def JACOBIAN_MAX_STEP
+ * biggest x or y correction in tenths of a mm one Jacobian step takes
+ * @def IK_NEWTON_ITERATIONS
+ * most Jacobian steps incrementalIK takes per solve
+ * @def IK_NEWTON_TOLERANCE
+ * x and y error in tenths of a mm incrementalIK calls converged, a bit more
+ * than a tenth of a degree moves the end effector at full reach
+ */
+#define LINK_2_TENTHS ((long)(LINK_2_Length * TENTHS_PER_MM + 0.5))
+#define LINK_3_TENTHS ((long)(LINK_3_Length * TENTHS_PER_MM + 0.5))
+#define RAD_TO_TENTHS 573
+#define JACOBIAN_MIN_COS 5690
+#define JACOBIAN_MAX_STEP 100
+#define IK_NEWTON_ITERATIONS 3
+#define IK_NEWTON_TOLERANCE 4
+
+/**
+ * @def CORDIC_STEPS
+ * number of CORDIC iterations, enough for better than 0.01 degrees
+ */
+#define CORDIC_STEPS 15
+
+/**
+ * @var cordicAngles
+ * atan(2^-i) in 1/256ths of a degree
+ */
+const int cordicAngles[CORDIC_STEPS] PROGMEM = {
+	11520, 6801, 3593, 1824, 916, 458, 229, 115, 57, 29, 14, 7, 4, 2, 1
+};
+
+/**
+ * @var sinTable
+ * sin of 0 to 90 degrees in whole degree steps, Q15
+ */
+const int sinTable[91] PROGMEM = {
+	0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126,
+	5690, 6252, 6813, 7371, 7927, 8481, 9032, 9580, 10126, 10668,
+	11207, 11743, 12275, 12803, 13328, 13848, 14364, 14876, 15383, 15886,
+	16383, 16876, 17364, 17846, 18323, 18794, 19260, 19720, 20173, 20621,
+	21062, 21497, 21925, 22347, 22762, 23170, 23571, 23964, 24351, 24730,
+	25101, 25465, 25821, 26169, 26509, 26841, 27165, 27481, 27788, 28087,
+	28377, 28659, 28932, 29196, 29451, 29697, 29934, 30162, 30381, 30591,
+	30791, 30982, 31163, 31335, 31498, 31650, 31794, 31927, 32051, 32165,
+	32269, 32364, 32448, 32523, 32587, 32642, 32687, 32722, 32747, 32762,
+	32767
+};
+
+/**
+ * @brief looks up the sine of an angle
+ * @param angle angle in tenths of a degree, any range
+ *
+ * @return sine of the angle in Q15
+ */
+int sinTenths(int angle){
+	BOOL negate = FALSE;
+	// wrap into 0 to 360 degrees
+	angle %= 3600;
+	if(angle < 0)
+		angle += 3600;
+	// fold the bottom half of the circle onto the top
+	if(angle >= 1800){
+		angle -= 1800;
+		negate = TRUE;
+	}
+	// fold 90 to 180 onto 90 to 0
+	if(angle > 900)
+		angle = 1800 - angle;
+
+	// interpolate between the whole degrees either side
+	unsigned char index = angle / TENTHS_PER_DEGREE;
+	unsigned char frac = angle % TENTHS_PER_DEGREE;
+	int result = pgm_read_word(&sinTable[index]);
+	if(frac)
+		result += ((int)pgm_read_word(&sinTable[index + 1]) - result) * frac / TENTHS_PER_DEGREE;
+
+	return negate ? -result : result;
+}
+
+/**
+ * @brief looks up the cosine of an angle
+ * @param angle angle in tenths of a degree, any range
+ *
+ * @return cosine of the angle in Q15
+ */
+int cosTenths(int angle){
+	return sinTenths(angle + 900);
+}
+
+/**
+ * @brief fixed point forward kinematics for the end of link 3
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ * @param x where to put x in tenths of a mm
+ * @param y where to put y in tenths of a mm
+ */
+void forwardKinematics(int theta1, int theta2, int *x, int *y){
+	// link 3 angle with horizontal, same as calcXY
+	int link3Angle = theta1 + theta2 - 900;
+
+	// Q4 lengths times Q15 trig, then drop the 19 fraction bits (rounded)
+	long sumX = LINK_2_Q4 * cosTenths(theta1) + LINK_3_Q4 * cosTenths(link3Angle);
+	long sumY = LINK_2_Q4 * sinTenths(theta1) + LINK_3_Q4 * sinTenths(link3Angle);
+	*x = (sumX + (1L << 18)) >> 19;
+	*y = ((sumY + (1L << 18)) >> 19) + ((LINK_1_Q4 + 8) >> 4);
+}
+
+/**
+ * @brief fixed point atan2 by CORDIC
+ * @param y y component, any scale
+ * @param x x component, same scale as y
+ *
+ * @return angle of (x,y) in tenths of a degree, -1800 to 1800
+ */
+int atan2Tenths(long y, long x){
+	long angle = 0; // in 1/256ths of a degree
+	long xNew;
+	unsigned char i;
+
+	if(x == 0 && y == 0)
+		return 0;
+	// rotate the left half plane onto the right, CORDIC only covers +-99 deg
+	if(x < 0){
+		angle = (y >= 0) ? 180L * 256 : -180L * 256;
+		x = -x;
+		y = -y;
+	}
+	// scale so the biggest component sits just under 2^29, which leaves room
+	// for the CORDIC gain of 1.65 and keeps the small steps meaningful
+	while(x >= (1L << 29) || y >= (1L << 29) || y <= -(1L << 29)){
+		x >>= 1;
+		y >>= 1;
+	}
+	while(x < (1L << 28) && y < (1L << 28) && y > -(1L << 28)){
+		x <<= 1;
+		y <<= 1;
+	}
+
+	// rotate the vector onto the x axis, adding up the rotations
+	for(i = 0; i < CORDIC_STEPS; i++){
+		if(y > 0){
+			xNew = x + (y >> i);
+			y -= x >> i;
+			angle += pgm_read_word(&cordicAngles[i]);
+		}
+		else {
+			xNew = x - (y >> i);
+			y += x >> i;
+			angle -= pgm_read_word(&cordicAngles[i]);
+		}
+		x = xNew;
+	}
+	// 1/256ths of a degree to tenths, rounded
+	return (angle * TENTHS_PER_DEGREE + (angle >= 0 ? 128 : -128)) / 256;
+}
+
+/**
+ * @brief integer square root
+ * @param value number to take the root of
+ *
+ * @return floor of the square root
+ */
+unsigned int isqrt32(unsigned long value){
+	unsigned long root = 0;
+	unsigned long bit = 1UL << 30;
+	// find the result one bit at a time, highest first
+	while(bit > value)
+		bit >>= 2;
+	while(bit){
+		if(value >= root + bit){
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+			root >>= 1;
+		bit >>= 2;
+	}
+	return root;
+}
+
+/**
+ * @brief fixed point inverse kinematics, elbow up like setPosition
+ * @param x desired x in tenths of a mm
+ * @param y desired y in tenths of a mm
+ * @param theta1 where to put joint 1 in tenths of a degree
+ * @param theta2 where to put joint 2 in tenths of a degree
+ *
+ * @return FALSE if the point is out of reach (angles are left alone)
+ */
+BOOL inverseKinematics(int x, int y, int *theta1, int *theta2){
+	// subtract Link1 (vertical) length from requested y value
+	long _y = y - LINK_1_TENTHS;
+	long rr = (long)x * x + _y * _y;
+
+	// law of cosines with everything scaled by 2 L2 L3 so it stays integer:
+	// cos of the elbow bend is r^2 - L2^2 - L3^2 and its sin is
+	// sqrt(((L2+L3)^2 - r^2)(r^2 - (L2-L3)^2)), each factor rooted on its own
+	long far = LINK_SUM_SQUARED - rr;
+	long near = rr - LINK_DIFF_SQUARED;
+	if(far < 0 || near < 0)
+		return FALSE; // out of reach
+	// 6 extra bits through the roots keeps the bend accurate near full reach
+	long sinElbow = ((long)isqrt32(far << 6) * isqrt32(near << 6)) >> 6;
+	long cosElbow = rr - LINKS_SQUARED;
+
+	// elbow bend from straight, then the offset of link 2 from the
+	// shoulder-to-target line: atan2(L3 sin, L2 + L3 cos), which is
+	// atan2(sin, 2 L2^2 + cos) in the scaled units
+	int elbow = atan2Tenths(sinElbow, cosElbow);
+	int offset = atan2Tenths(sinElbow, TWO_LINK_2_SQUARED + cosElbow);
+
+	*theta1 = atan2Tenths(_y, x) + offset;
+	*theta2 = 900 - elbow; // joint 2 reads 90 with the arm straight
+	return TRUE;
+}
+
+/**
+ * @brief turns a small end effector move into joint moves with the inverse
+ * Jacobian at the given angles
+ * @details the determinant is -L2 L3 cos(theta2), so it goes singular with
+ * the arm straight (theta2 = 90). Moves bigger than JACOBIAN_MAX_STEP are
+ * clamped.
+ * @param theta1 joint 1 angle in tenths of a degree
+ * @param theta2 joint 2 angle in tenths of a degree
+ * @param dx x move in tenths of a mm
+ * @param dy y move in tenths of a mm
+ * @param dTheta1 where to put the joint 1 move in tenths of a degree
+ * @param dTheta2 where to put the joint 2 move in tenths of a degree
+ *
+ * @return FALSE if the arm is too close to straight to invert the Jacobian
+ */
+BOOL jacobianStep(int theta1, int theta2, int dx, int dy, int *dTheta1, int *dTheta2){
+	int cos2 = cosTenths(theta2);
+	if(cos2 < JACOBIAN_MIN_COS && cos2 > -JACOBIAN_MIN_COS)
+		return FALSE; // too close to straight
+
+	if(dx > JACOBIAN_MAX_STEP)
+		dx = JACOBIAN_MAX_STEP;
+	else if(dx < -JACOBIAN_MAX_STEP)
+		dx = -JACOBIAN_MAX_STEP;
+	if(dy > JACOBIAN_MAX_STEP)
+		dy = JACOBIAN_MAX_STEP;
+	else if(dy < -JACOBIAN_MAX_STEP)
+		dy = -JACOBIAN_MAX_STEP;
+
+	// link 3 angle with horizontal, same as forwardKinematics
+	int link3Angle = theta1 + theta2 - 900;
+	int cos3 = cosTenths(link3Angle);
+	int sin3 = sinTenths(link3Angle);
+	// end effector relative to the shoulder in tenths of a mm
+	long px = (LINK_2_Q4 * cosTenths(theta1) + LINK_3_Q4 * cos3 + (1L << 18)) >> 19;
+	long py = (LINK_2_Q4 * sinTenths(theta1) + LINK_3_Q4 * sin3 + (1L << 18)) >> 19;
+
+	// J^-1 = 1/(-L2 L3 cos2) [L3 cos3, L3 sin3; -px, -py], so
+	// dTheta1 = -(cos3 dx + sin3 dy) / (L2 cos2)
+	// dTheta2 = (px dx + py dy) / (L2 L3 cos2)
+	// L2 cos2 is kept with 7 fraction bits and L2 L3 cos2 with none
+	long link2Cos = (LINK_2_TENTHS * cos2) >> 8;
+	long link23Cos = (link2Cos * LINK_3_TENTHS) >> 7;
+	long along = ((long)cos3 * dx + (long)sin3 * dy) >> 8;
+	long radial = px * dx + py * dy;
+	*dTheta1 = -along * RAD_TO_TENTHS / link2Cos;
+	*dTheta2 = radial * RAD_TO_TENTHS / link23Cos;
+	return TRUE;
+}
+
+/**
+ * @brief inverse kinematics by Newton's method, warm started from the angles
+ * passed in
+ * @details each iteration is a fixed point FK and a Jacobian step on the
+ * error, so a point close to the last one converges in one or two. Far
+ * points and points near the straight arm singularity fail, and the angles
+ * are left alone for the analytic IK to take over.
+ * @param x desired x in tenths of a mm
+ * @param y desired y in tenths of a mm
+ * @param theta1 joint 1 angle to start from, and where to put the answer, in
+ * tenths of a degree
+ * @param theta2 joint 2 angle to start from, and where to put the answer, in
+ * tenths of a degree
+ *
+ * @return FALSE if it didn't converge
+ */
+BOOL incrementalIK(int x, int y, int *theta1, int *theta2){
+	int t1 = *theta1;
+	int t2 = *theta2;
+	unsigned char i;
+	for(i = 0; i < IK_NEWTON_ITERATIONS; i++){
+		int fx, fy;
+		int d1, d2;
+		forwardKinematics(t1, t2, &fx, &fy);
+		int dx = x - fx;
+		int dy = y - fy;
+		if(betweenTwoVals(dx, -IK_NEWTON_TOLERANCE, IK_NEWTON_TOLERANCE)
+				&& betweenTwoVals(dy, -IK_NEWTON_TOLERANCE, IK_NEWTON_TOLERANCE)){
+			*theta1 = t1;
+			*theta2 = t2;
+			return TRUE;
+		}
+		if(!jacobianStep(t1, t2, dx, dy, &d1, &d2))
+			return FALSE; // too close to straight
+		t1 += d1;
+		t2 += d2;
+	}
+	return FALSE;
+}
+
+/**
+ * @brief inverse kinematics by bilinear interpolation of the PROGMEM grid
+ * @details only covers the conveyor workspace, and skips cells near the
+ * edge of reach where interpolation isn't accurate enough (see ikGridGen)
+ * @param x desired x in tenths of a mm
+ * @param y desired y in tenths of a mm
+ * @param theta1 where to put joint 1 in tenths of a degree
+ * @param theta2 where to put joint 2 in tenths of a degree
+ *
+ * @return FALSE if the point isn't covered by a usable grid cell
+ */
+BOOL inverseKinematicsGrid(int x, int y, int *theta1, int *theta2){
+	const int step = IK_GRID_STEP * TENTHS_PER_MM;
+	// position inside the grid in tenths of a mm
+	int fx = x - IK_GRID_X_MIN * TENTHS_PER_MM;
+	int fy = y - IK_GRID_Y_MIN * TENTHS_PER_MM;
+	if(fx < 0 || fy < 0 || fx > (IK_GRID_COLS - 1) * step || fy > (IK_GRID_ROWS - 1) * step)
+		return FALSE;
+
+	// find the cell, points on the far edges belong to the last one
+	unsigned char col = fx / step;
+	unsigned char row = fy / step;
+	if(col >= IK_GRID_COLS - 1)
+		col = IK_GRID_COLS - 2;
+	if(row >= IK_GRID_ROWS - 1)
+		row = IK_GRID_ROWS - 2;
+	if(!(pgm_read_byte(&ikGridCellOK[row][col / 8]) & BIT(col % 8)))
+		return FALSE;
+	fx -= col * step;
+	fy -= row * step;
+
+	// weight each corner by the area of the opposite sub-rectangle
+	long w00 = (long)(step - fx) * (step - fy);
+	long w01 = (long)fx * (step - fy);
+	long w10 = (long)(step - fx) * fy;
+	long w11 = (long)fx * fy;
+	int *result[2] = {theta1, theta2};
+	unsigned char joint;
+	for(joint = 0; joint < 2; joint++){
+		long sum = w00 * (int)pgm_read_word(&ikGrid[row][col][joint])
+				+ w01 * (int)pgm_read_word(&ikGrid[row][col + 1][joint])
+				+ w10 * (int)pgm_read_word(&ikGrid[row + 1][col][joint])
+				+ w11 * (int)pgm_read_word(&ikGrid[row + 1][col + 1][joint]);
+		// divide out step^2, rounded
+		*result[joint] = (sum + (sum >= 0 ? 1 : -1) * ((long)step * step / 2)) / ((long)step * step);
+	}
+	return TRUE;
+}
+
+/**
+ * @brief floating point inverse kinematics, the old setPosition math
+ * @param x desired x in mm
+ * @param y desired y in mm
+ * @param theta1 where to put joint 1 in degrees
+ * @param theta2 where to put joint 2 in degrees
+ */
+void inverseKinematicsFloat(float x, float y, float *theta1, float *theta2){
+	// subtract Link1 (vertical) length from requested y value
+	float _y = y - LINK_1_Length;
+	// optimization - cache these calculations
+	float xx = pow(x,2);
+	float yy = pow(_y,2);
+	float L2L2 = LINK_2_Length * LINK_2_Length;
+	float L3L3 = LINK_3_Length * LINK_3_Length;
+
+	*theta1 = (atan2f(_y,x)+acos((xx+yy+L2L2-L3L3)/(2*LINK_2_Length*(sqrt((xx+yy))))))
+			* DEGREES_TO_RADIANS;
+	*theta2 = (acos(((L2L2)+(L3L3)-(xx+yy))/(2*LINK_2_Length*LINK_3_Length))-(3.14159/2))
+			* DEGREES_TO_RADIANS;
+}
+
+/**
+ * @brief rounds a fixed point angle to the nearest whole degree
+ * @param angle angle in tenths of a degree
+ *
+ * @return angle in degrees
+ */
+int tenthsToDegrees(int angle){
+	if(angle >= 0)
+		return (angle + TENTHS_PER_DEGREE / 2) / TENTHS_PER_DEGREE;
+	else
+		return (angle - TENTHS_PER_DEGREE / 2) / TENTHS_PER_DEGREE;
+}
+
+/**
+ * @brief sweeps the workspace and prints the worst difference between
+ * inverseKinematics, inverseKinematicsGrid and inverseKinematicsFloat, and
+ * the cycles each takes
+ */
+void printIKAccuracy(){
+	float maxError = 0;
+	float maxGridError = 0;
+	unsigned long fixedCycles = 0;
+	unsigned long floatCycles = 0;
+	unsigned long gridCycles = 0;
+	unsigned int samples = 0;
+	unsigned int gridSamples = 0;
+	unsigned int cycles;
+	int x, y;
+	int theta1, theta2;
+	float theta1Float, theta2Float;
+
+	// every 10mm over the reachable part of the workspace in front of the arm
+	for(x = 1000; x <= 3000; x += 100){
+		for(y = 500; y <= 3500; y += 100){
+			startCycleCount();
+			BOOL reachable = inverseKinematics(x, y, &theta1, &theta2);
+			cycles = readCycleCount();
+			if(!reachable)
+				continue;
+			fixedCycles += cycles;
+			startCycleCount();
+			inverseKinematicsFloat(x / 10.0, y / 10.0, &theta1Float, &theta2Float);
+			floatCycles += readCycleCount();
+
+			float error1 = fabs(theta1 / 10.0 - theta1Float);
+			float error2 = fabs(theta2 / 10.0 - theta2Float);
+			if(error1 > maxError)
+				maxError = error1;
+			if(error2 > maxError)
+				maxError = error2;
+			samples++;
+		}
+	}
+
+	// every 3.7mm over the grid so points land all over the cells
+	for(x = IK_GRID_X_MIN * TENTHS_PER_MM; x <= 3200; x += 37){
+		for(y = IK_GRID_Y_MIN * TENTHS_PER_MM; y <= 2510; y += 37){
+			startCycleCount();
+			BOOL inGrid = inverseKinematicsGrid(x, y, &theta1, &theta2);
+			cycles = readCycleCount();
+			if(!inGrid)
+				continue;
+			gridCycles += cycles;
+			inverseKinematicsFloat(x / 10.0, y / 10.0, &theta1Float, &theta2Float);
+
+			float error1 = fabs(theta1 / 10.0 - theta1Float);
+			float error2 = fabs(theta2 / 10.0 - theta2Float);
+			if(error1 > maxGridError)
+				maxGridError = error1;
+			if(error2 > maxGridError)
+				maxGridError = error2;
+			gridSamples++;
+		}
+	}
+
+	printf("IK points,Max error(deg),Fixed cycles,Float cycles,"
+			"Grid points,Grid max error(deg),Grid cycles\n\r");
+	printf("%u,%.3f,%lu,%lu,%u,%.3f,%lu\n\r", samples, maxError,
+			fixedCycles / samples, floatCycles / samples, gridSamples,
+			maxGridError, gridSamples ? gridCycles / gridSamples : 0);
+}
+
+/**
+ * @brief floating point forward kinematics, the reference calcXY uses
+ * @param theta1 joint 1 angle in degrees
+ * @param theta2 joint 2 angle in degrees
+ * @param x where to put x in mm
+ * @param y where to put y in mm
+ */
+void forwardKinematicsFloat(float theta1, float theta2, float *x, float *y){
+	// calc joint angles
+	float Joint1Angle = theta1*RADS_PER_DEGREE;
+	float Joint2Angle = theta2*RADS_PER_DEGREE;
+
+	// forward kinematics to calculate coordinates of end of link 2
+	float x1 = LINK_2_Length*cos(Joint1Angle);
+	float y1 = LINK_1_Length+(LINK_2_Length*sin(Joint1Angle));
+
+	// forward kinematics to calculate coordinates of end effector link 3
+	*x = x1 + LINK_3_Length*cos(Joint2Angle -(3.14159/2.0)+ Joint1Angle);
+	*y = y1 + LINK_3_Length*sin(Joint2Angle-(3.14159/2.0)+ Joint1Angle);
+}
+
+/**
+ * @brief sweeps the joint range and prints the worst and RMS difference
+ * between forwardKinematics and forwardKinematicsFloat
+ */
+void printFKAccuracy(){
+	float maxError = 0;
+	float sumSquares = 0;
+	unsigned int samples = 0;
+	int theta1, theta2;
+	int xFixed, yFixed;
+	float xFloat, yFloat;
+
+	// every 2.5 degrees over the joint ranges the arm actually uses
+	for(theta1 = 0; theta1 <= 1800; theta1 += 25){
+		for(theta2 = -900; theta2 <= 1800; theta2 += 25){
+			forwardKinematics(theta1, theta2, &xFixed, &yFixed);
+			forwardKinematicsFloat(theta1 / 10.0, theta2 / 10.0, &xFloat, &yFloat);
+			float dx = xFixed / 10.0 - xFloat;
+			float dy = yFixed / 10.0 - yFloat;
+			float error = sqrt(dx * dx + dy * dy);
+			if(error > maxError)
+				maxError = error;
+			sumSquares += error * error;
+			samples++;
+		}
+	}
+	printf("FK points,Max error(mm),RMS error(mm)\n\r");
+	printf("%u,%.3f,%.3f\n\r", samples, maxError, sqrt(sumSquares / samples));
+}
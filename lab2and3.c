@@ -13,6 +13,7 @@
 #include "include/definitions.h"
 #include "include/arm.h"
 #include "include/button.h"
+#include "include/recorder.h"
 
 /**
  * @brief prints the header for streaming joint angles
@@ -189,49 +190,27 @@ void controlJoint1WithButtons(){
 void drawTriangleWithButtons(){
 	static unsigned char lastState = 0;
 
-	static int point = 0; // point of triangle to track for scripted triangle
-	static int pointArray[50][2]; // for storing recorded motion
-	// todo make the array size not a magic number
-	static unsigned long pointIndex = 0; // point index for the array
-	static unsigned long drawingIndex = 0; // index for drawing points
+	static BOOL drawing = FALSE; // TRUE until the scripted triangle is done
 
 	// switch based on the button pressed
 	switch (lastButtonPressed()) {
 	// draw scripted triangle
 	case 4:
-		// if new case, print that we are starting the draw
+		// if new case, queue the corners up and let serviceArm draw them
+		// todo make these defined constants
 		if (lastState != 4){
 			printf("Drawing Triangle\n\r");
-			point = 0;
+			clearMotionQueue();
+			queueJointMove(730, -240, TRAJ_MIN_JERK, 0);
+			queueJointMove(1240, -130, TRAJ_MIN_JERK, 0);
+			queueJointMove(560, 680, TRAJ_MIN_JERK, 0);
+			queueJointMove(730, -240, TRAJ_MIN_JERK, 0);
+			endMotionSequence(); // back at the first corner is the end
+			drawing = TRUE;
 		}
-		// switch based on what point of the triangle we are on
-		switch(point){
-		// each case changes the angles the arm goes in, case moves on when
-		// the arm is in position
-		// todo make these defined constants
-		case 0:
-			setJointAngles(73,-24);
-			if(inPosition(73,-24))
-				point = 1;
-			break;
-		case 1:
-			setJointAngles(124, -13);
-			if (inPosition(124, -13))
-				point = 2;
-			break;
-		case 2:
-			setJointAngles(56, 68);
-			if (inPosition(56, 68))
-				point = 3;
-			break;
-		case 3:
-			setJointAngles(73, -24);
-			if (inPosition(73, -24))
-				point = 4;
-			break;
-		default:
+		if (drawing && doneMoving()){
 			printf("Done triangle.\n\r");
-			break;
+			drawing = FALSE;
 		}
 		lastState = 4;
 		break;
@@ -243,36 +222,23 @@ void drawTriangleWithButtons(){
 		setJointAngles(2, 181);
 		lastState = 5;
 		break;
-	// record points until array is filled
+	// record the joints until another button or the storage fills
 	case 6:
 		if (lastState != 6){
 			printf("record triangle\n\r");
-			pointIndex = 0;
-		}
-
-		// stash points in the array until it fills
-		if(pointIndex < 50){
-			pointArray[pointIndex][0] = getJointAngle(1);
-			pointArray[pointIndex][1] = getJointAngle(2);
-			pointIndex++;
-		}
-		else {
-			printf("done recording\n\r");
+			startRecording(RECORD_PERIOD, TRUE); // serviceArm samples it
 		}
 		lastState = 6;
 
 		break;
-	// play back the stored points in the array
+	// play back the recording, or the one saved in EEPROM after a reset
 	case 7:
 		if (lastState != 7){
 			printf("draw points\n\r");
-			drawingIndex = 0;
-		}
-
-		// keep setting the joints from the array until we hit the index
-		if(drawingIndex<50){
-			setJointAngles(pointArray[drawingIndex][0], pointArray[drawingIndex][1]);
-			drawingIndex++;
+			stopRecording();
+			if(!startPlayback() && !(loadRecording() && startPlayback()))
+				printf("nothing recorded\n\r");
+			printRecording();
 		}
 		lastState = 7;
 
@@ -21,6 +21,9 @@
 #include "include/FSM.h"
 #include "include/gripper.h"
 #include "include/PC_Interface.h"
+#include "include/ADC.h"
+#include "include/conveyor.h"
+#include "include/jointState.h"
 
 /**
  * @brief main loop for AVR chip
@@ -34,6 +37,10 @@ int main(void) {
 
 	initSPI(); // initialize SPI communications
 	initArm(); // initialize the arm'
+	setADCOversample(IR_FRONT_PIN, IR_OVERSAMPLE_BITS); // quieter IR readings
+	setADCOversample(IR_BACK_PIN, IR_OVERSAMPLE_BITS);
+	initConveyorTracker(); // timestamp blocks going past the IR sensors
+	offerArmSetup(controlTicksPerSec); // 1 second to ask for calibration or tuning
 
 	stopConveyor(); // initialize servo positions
 	openGripper();
@@ -46,6 +53,7 @@ int main(void) {
 	while (1) {
 		finiteStateMachine(); // run FSM to determine what arm needs to do
 		serviceArm(); // allow arm to react to changes and service PID if needed
+		reportJointSlips(); // print encoder slips outside the control tick
 	}
 	return 0;
 }
@@ -10,6 +10,9 @@
 #include "RBELib/RBELib.h"
 #include "include/definitions.h"
 #include "include/arm.h"
+#include "include/kinematics.h"
+#include "include/jointState.h"
+#include "include/PID.h"
 
 /**
  * @brief Helper function to stop the motors on the arm.
@@ -30,24 +33,64 @@ void stopMotors(){
  *
  */
 void gotoAngles(int lowerTheta, int upperTheta){
+	jointTarget targets[PID_NUM_JOINTS] = {
+		{lowerTheta * TENTHS_PER_DEGREE, 0, 0},
+		{upperTheta * TENTHS_PER_DEGREE, 0, 0}
+	};
+	trackJoints(targets);
+}
+
+/**
+ * @brief Drive the arm along a joint trajectory, one tick at a time
+ *
+ * @param targets angle, velocity and acceleration for each joint this tick,
+ * joint 1 first
+ */
+void trackJoints(const jointTarget *targets){
+	int angles[PID_NUM_JOINTS];
+	int joint;
+	for(joint = 0; joint < PID_NUM_JOINTS; joint++)
+		angles[joint] = getJointTenths(joint + 1);
+	lastJoint1Angle = tenthsToDegrees(angles[0]); // for grav compensation on top link
+
 	// compute PID control values and drive the link to those outputs
-	lastJoint1Angle = getJointAngle(1); // for grav compensation on top link
-	PID = calcPID(2,upperTheta,getJointAngle(2));
-	driveLink(3,PID);
-	int PID2 = calcPID(1,lowerTheta,getJointAngle(1));
-	driveLink(2,PID2);
+	for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+		int output = updatePIDController(&pidControllers[joint], &targets[joint], angles[joint],
+				gravityFeedforward(joint + 1, angles[0], angles[1]));
+		driveLink(joint + 2, output); // joint 1 moves link 2
+	}
+	PID = pidControllers[1].output; // upper joint for logging
 }
 
 /**
  * @brief Drive the end effector of the arm to a desired X and Y position in the workspace.
+ * @details The joint setpoints are solved incrementally: Newton's method on
+ * the fixed point FK, warm started from last tick's setpoints, which
+ * converges in a step or two when called every tick with a point moving
+ * along a path. Near the straight arm singularity, or after a jump it can't
+ * follow, it solves the IK from scratch instead.
  *
- * @param x The desired x position for the end effector.
- * @param y The desired y position for the end effector.
- *
- * @todo Use kinematic equations to move the end effector to the desired position.
+ * @param x The desired x position for the end effector in tenths of a mm.
+ * @param y The desired y position for the end effector in tenths of a mm.
  */
 void gotoXY(int x, int y){
+	jointTarget targets[PID_NUM_JOINTS] = {{0, 0, 0}, {0, 0, 0}};
+	int theta1 = lowerAngleTenths;
+	int theta2 = upperAngleTenths;
+	if(incrementalIK(x, y, &theta1, &theta2)){
+		// the setpoint moves are the joint rates the line needs, lines run
+		// at constant speed so there is no acceleration to feed forward
+		targets[0].velocity = (theta1 - lowerAngleTenths) * (int)controlTicksPerSec;
+		targets[1].velocity = (theta2 - upperAngleTenths) * (int)controlTicksPerSec;
+		lowerAngleTenths = theta1;
+		upperAngleTenths = theta2;
+	}
+	else
+		inverseKinematics(x, y, &lowerAngleTenths, &upperAngleTenths);
 
+	targets[0].position = lowerAngleTenths;
+	targets[1].position = upperAngleTenths;
+	trackJoints(targets);
 }
 
 /**
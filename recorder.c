@@ -0,0 +1,468 @@
+/** @brief joint motion recorder
+ *
+ * @file recorder.c
+ *
+ * A recording is a stream of bytes. Most samples are one byte, the change of
+ * each joint since the last sample packed into a signed nibble, which covers
+ * moves up to 0.7 degrees a sample. Bigger changes escape to a byte each, or
+ * to the whole angles, and a late sample puts the extra ticks in front of it
+ * so playback keeps the timing. The stream goes into an SRAM ring and, when
+ * spilling, one byte a tick drains from the ring into EEPROM, so the
+ * recording can be as long as both. A recording that fully drains is saved
+ * with a header and can be played after a reset.
+ *
+ * @author cpbove@wpi.edu
+ * @date 12-Mar-2016
+ * @version 1.0
+ */
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h"
+#include "include/arm.h"
+#include "include/jointState.h"
+#include "include/recorder.h"
+#include <avr/eeprom.h>
+#include <stdint.h>
+
+/**
+ * @var recordMagic
+ * RECORD_MAGIC once a recording has fully drained into EEPROM
+ *
+ * @var recordSaved
+ * bytes, control rate and sample period of the saved recording
+ *
+ * @var recordSpill
+ * EEPROM the start of a spilling recording drains into
+ */
+uint16_t EEMEM recordMagic;
+uint16_t EEMEM recordSavedLength;
+uint16_t EEMEM recordSavedRate;
+uint8_t EEMEM recordSavedPeriod;
+uint8_t EEMEM recordSpill[RECORD_EEPROM_SIZE];
+
+/**
+ * @var recordBuffer
+ * SRAM ring the recording is written into, byte i goes in i mod its size
+ *
+ * @var recordLength
+ * bytes in the recording
+ *
+ * @var recordSpilled
+ * bytes at the start of the recording that are in EEPROM, the rest are still
+ * in recordBuffer
+ *
+ * @var recordSpilling
+ * TRUE if the recording drains into EEPROM
+ *
+ * @var recordRunning
+ * TRUE while samples are being taken
+ *
+ * @var recordSaveStep
+ * which header field serviceRecorder writes next once the recording has
+ * drained, 0 for none
+ */
+unsigned char recordBuffer[RECORD_BUFFER_SIZE];
+unsigned int recordLength;
+unsigned int recordSpilled;
+BOOL recordSpilling;
+BOOL recordRunning;
+unsigned char recordSaveStep;
+
+/**
+ * @var recordPeriod
+ * control ticks between samples
+ *
+ * @var recordRate
+ * control rate the recording was made at
+ *
+ * @var recordSamples
+ * samples in the recording
+ *
+ * @var recordTicks
+ * control ticks from the first sample to the last
+ *
+ * @var recordLastTick
+ * timerCount at the last sample
+ *
+ * @var recordLast
+ * angle of each joint at the last sample, joint 1 first
+ */
+unsigned char recordPeriod;
+unsigned int recordRate;
+unsigned int recordSamples;
+unsigned long recordTicks;
+unsigned long recordLastTick;
+int recordLast[PID_NUM_JOINTS];
+
+/**
+ * @var playbackState
+ * PLAYBACK_IDLE, PLAYBACK_APPROACH or PLAYBACK_RUN
+ *
+ * @var playIndex
+ * next byte of the recording to decode
+ *
+ * @var playAngles
+ * angle of each joint at the last decoded sample
+ *
+ * @var playFrom
+ * angle of each joint at the start of the span being played
+ *
+ * @var playTo
+ * angle of each joint at the end of the span being played
+ *
+ * @var playSpan
+ * control ticks the span takes at the current rate
+ *
+ * @var playTick
+ * ticks of the span played so far, or of the approach left
+ *
+ * @var playRemainder
+ * part of a tick the spans so far have left over, in 1 / recordRate ticks
+ */
+unsigned char playbackState = PLAYBACK_IDLE;
+unsigned int playIndex;
+int playAngles[PID_NUM_JOINTS];
+int playFrom[PID_NUM_JOINTS];
+int playTo[PID_NUM_JOINTS];
+unsigned int playSpan;
+unsigned int playTick;
+unsigned int playRemainder;
+
+/**
+ * @brief starts a new recording of the joint angles
+ * @param period control ticks between samples
+ * @param spill TRUE to drain the recording into EEPROM while it runs
+ */
+void startRecording(unsigned char period, BOOL spill){
+	stopPlayback(); // the playback reads the buffer this writes
+	recordRunning = FALSE; // don't let serviceRecorder see a half reset recording
+	recordLength = 0;
+	recordSpilled = 0;
+	recordSaveStep = 0;
+	recordSamples = 0;
+	recordTicks = 0;
+	recordPeriod = period ? period : 1;
+	recordRate = controlTicksPerSec;
+	recordSpilling = spill;
+	if(spill)
+		eeprom_update_word(&recordMagic, 0); // the old one is being written over
+	recordRunning = TRUE;
+}
+
+/**
+ * @brief stops recording, anything waiting still drains into EEPROM
+ */
+void stopRecording(){
+	recordRunning = FALSE;
+	// already drained, nothing left for serviceRecorder to save it after
+	if(recordSpilling && recordLength && recordSpilled == recordLength)
+		recordSaveStep = 1;
+}
+
+/**
+ * @brief checks if a recording is running
+ *
+ * @return TRUE until stopRecording or the storage fills
+ */
+BOOL recording(){
+	return recordRunning;
+}
+
+/**
+ * @brief checks there is room for more of the recording
+ * @param bytes how many bytes are about to be written
+ *
+ * @return TRUE if they fit in the ring without writing over bytes that
+ * haven't drained
+ */
+BOOL recordRoom(unsigned int bytes){
+	return recordLength - recordSpilled + bytes <= RECORD_BUFFER_SIZE;
+}
+
+/**
+ * @brief adds a byte to the end of the recording
+ * @param value byte to add
+ */
+void writeRecordByte(unsigned char value){
+	recordBuffer[recordLength & (RECORD_BUFFER_SIZE - 1)] = value;
+	recordLength++;
+}
+
+/**
+ * @brief gets a byte of the recording from EEPROM or the ring
+ * @param index which byte
+ *
+ * @return the byte
+ */
+unsigned char readRecordByte(unsigned int index){
+	if(index < recordSpilled)
+		return eeprom_read_byte(&recordSpill[index]);
+	return recordBuffer[index & (RECORD_BUFFER_SIZE - 1)];
+}
+
+/**
+ * @brief encodes one sample of the joint angles onto the recording
+ * @param angles angle of each joint, joint 1 first
+ * @param gap ticks late the sample is, up to 255
+ */
+void encodeSample(const int *angles, unsigned char gap){
+	int d1 = angles[0] - recordLast[0];
+	int d2 = angles[1] - recordLast[1];
+
+	if(gap){
+		writeRecordByte(RECORD_GAP);
+		writeRecordByte(gap);
+	}
+	if(!recordSamples || d1 < -128 || d1 > 127 || d2 < -128 || d2 > 127){
+		// first sample or a jump, start again from the whole angles
+		writeRecordByte(RECORD_ABSOLUTE);
+		writeRecordByte(angles[0]);
+		writeRecordByte(angles[0] >> 8);
+		writeRecordByte(angles[1]);
+		writeRecordByte(angles[1] >> 8);
+	}
+	else if(d1 < -7 || d1 > 7 || d2 < -7 || d2 > 7){
+		writeRecordByte(RECORD_BYTE_DELTAS);
+		writeRecordByte(d1);
+		writeRecordByte(d2);
+	}
+	else
+		writeRecordByte((d1 << 4) | (d2 & 0x0F)); // never 0x8_, d1 isn't -8
+	recordLast[0] = angles[0];
+	recordLast[1] = angles[1];
+	recordSamples++;
+}
+
+/**
+ * @brief decodes the next sample of the recording
+ * @param index byte to decode from, moved past the sample
+ * @param angles angle of each joint at the last sample, updated to this one
+ * @param gap where to put the ticks the sample was late
+ *
+ * @return FALSE at the end of the recording
+ */
+BOOL decodeSample(unsigned int *index, int *angles, unsigned int *gap){
+	*gap = 0;
+	while(*index < recordLength){
+		unsigned char value = readRecordByte((*index)++);
+		if((value & 0xF0) != RECORD_ESCAPE){
+			// two nibble deltas, shifted up and back for the sign
+			angles[0] += (signed char)value >> 4;
+			angles[1] += (signed char)(value << 4) >> 4;
+			return TRUE;
+		}
+		if(value == RECORD_GAP){
+			*gap += readRecordByte((*index)++);
+			continue;
+		}
+		if(value == RECORD_BYTE_DELTAS){
+			angles[0] += (signed char)readRecordByte(*index);
+			angles[1] += (signed char)readRecordByte(*index + 1);
+			*index += 2;
+		}
+		else{
+			angles[0] = (int16_t)(readRecordByte(*index) | (readRecordByte(*index + 1) << 8));
+			angles[1] = (int16_t)(readRecordByte(*index + 2) | (readRecordByte(*index + 3) << 8));
+			*index += 4;
+		}
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * @brief writes one field of the saved recording's header
+ * @details one a tick so no tick waits on more than one EEPROM write
+ */
+void saveRecordingStep(){
+	switch(recordSaveStep){
+	case 1:
+		eeprom_update_word(&recordSavedLength, recordLength);
+		break;
+	case 2:
+		eeprom_update_word(&recordSavedRate, recordRate);
+		break;
+	case 3:
+		eeprom_update_byte(&recordSavedPeriod, recordPeriod);
+		break;
+	case 4:
+		eeprom_update_word(&recordMagic, RECORD_MAGIC);
+		recordSaveStep = 0;
+		return;
+	}
+	recordSaveStep++;
+}
+
+/**
+ * @brief takes a sample when one is due and moves a byte into EEPROM if
+ * it's free. Call every control tick.
+ */
+void serviceRecorder(){
+	if(recordRunning){
+		unsigned long ticks = timerCount - recordLastTick;
+		if(!recordSamples || ticks >= recordPeriod){
+			int angles[PID_NUM_JOINTS] = {getJointTenths(1), getJointTenths(2)};
+			unsigned long gap = recordSamples ? ticks - recordPeriod : 0;
+			if(gap > 255)
+				gap = 255; // a long stall plays back a bit short
+			if(recordRoom(RECORD_MAX_SAMPLE) && (!recordSpilling
+					|| recordLength + RECORD_MAX_SAMPLE <= RECORD_EEPROM_SIZE + RECORD_BUFFER_SIZE)){
+				encodeSample(angles, gap);
+				if(recordSamples > 1)
+					recordTicks += recordPeriod + gap;
+				recordLastTick = timerCount;
+			}
+			else
+				stopRecording(); // full
+		}
+	}
+
+	if(!recordSpilling)
+		return;
+	// drain a byte a tick while the EEPROM is free, then save the header
+	if(recordSpilled < recordLength && recordSpilled < RECORD_EEPROM_SIZE){
+		if(eeprom_is_ready()){
+			eeprom_update_byte(&recordSpill[recordSpilled], readRecordByte(recordSpilled));
+			recordSpilled++;
+			if(!recordRunning && recordSpilled == recordLength)
+				recordSaveStep = 1;
+		}
+	}
+	else if(recordSaveStep && eeprom_is_ready())
+		saveRecordingStep();
+}
+
+/**
+ * @brief loads the recording saved in EEPROM, if there is one
+ *
+ * @return TRUE if a saved recording was found
+ */
+BOOL loadRecording(){
+	if(eeprom_read_word(&recordMagic) != RECORD_MAGIC)
+		return FALSE;
+	stopPlayback();
+	recordRunning = FALSE;
+	recordSpilling = FALSE; // it's all in EEPROM already
+	recordSaveStep = 0;
+	recordLength = eeprom_read_word(&recordSavedLength);
+	recordSpilled = recordLength;
+	recordRate = eeprom_read_word(&recordSavedRate);
+	recordPeriod = eeprom_read_byte(&recordSavedPeriod);
+
+	// count it up so printRecording can say how long it is
+	unsigned int index = 0;
+	unsigned int gap;
+	int angles[PID_NUM_JOINTS] = {0, 0};
+	recordSamples = 0;
+	recordTicks = 0;
+	while(decodeSample(&index, angles, &gap)){
+		if(recordSamples++)
+			recordTicks += recordPeriod + gap;
+	}
+	return TRUE;
+}
+
+/**
+ * @brief moves the arm to the start of the recording, then plays it back
+ * at the timing it was recorded with
+ *
+ * @return FALSE if there is nothing to play
+ */
+BOOL startPlayback(){
+	stopRecording();
+	playIndex = 0;
+	unsigned int gap;
+	if(!decodeSample(&playIndex, playAngles, &gap))
+		return FALSE;
+	clearMotionQueue(); // a direct command takes over from the queue
+	playbackState = PLAYBACK_IDLE; // don't let serviceArm see a half started playback
+	playTick = moveJoints(playAngles[0], playAngles[1], TRAJ_MIN_JERK) + 1;
+	playFrom[0] = playTo[0] = playAngles[0];
+	playFrom[1] = playTo[1] = playAngles[1];
+	playSpan = 0;
+	playRemainder = 0;
+	playbackState = PLAYBACK_APPROACH;
+	return TRUE;
+}
+
+/**
+ * @brief stops a playback, the arm holds where it is
+ */
+void stopPlayback(){
+	if(playbackState == PLAYBACK_IDLE)
+		return;
+	playbackState = PLAYBACK_IDLE;
+	moveJoints(lowerAngleTenths, upperAngleTenths, TRAJ_STEP);
+}
+
+/**
+ * @brief checks if a playback is running
+ *
+ * @return TRUE while moving to the start or playing
+ */
+BOOL playingBack(){
+	return playbackState != PLAYBACK_IDLE;
+}
+
+/**
+ * @brief drives the arm to this tick's setpoints of the playback. Call every
+ * control tick while playingBack.
+ */
+void servicePlayback(){
+	jointTarget targets[PID_NUM_JOINTS];
+	int joint;
+
+	if(playbackState == PLAYBACK_APPROACH){
+		serviceTrajectory(); // on the way to the first sample
+		if(!--playTick)
+			playbackState = PLAYBACK_RUN;
+		return;
+	}
+
+	// on to the next span once this one is played, samples closer together
+	// than a tick at the rate now take no ticks and are skipped over
+	while(playTick >= playSpan){
+		unsigned int gap;
+		playFrom[0] = playTo[0];
+		playFrom[1] = playTo[1];
+		if(!decodeSample(&playIndex, playAngles, &gap)){
+			// that was the last sample, hold there
+			playbackState = PLAYBACK_IDLE;
+			moveJoints(playTo[0], playTo[1], TRAJ_STEP);
+			serviceTrajectory();
+			return;
+		}
+		playTo[0] = playAngles[0];
+		playTo[1] = playAngles[1];
+		// the span at the rate it was recorded at, in ticks at the rate now.
+		// The part of a tick left over carries on to the next span, so the
+		// spans add up to the recording's length and playback doesn't drift
+		unsigned long scaled = (unsigned long)(recordPeriod + gap) * controlTicksPerSec
+				+ playRemainder;
+		playSpan = scaled / recordRate;
+		playRemainder = scaled % recordRate;
+		playTick = 0;
+	}
+
+	// straight between the samples, with the span's speed fed forward
+	for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+		long distance = playTo[joint] - playFrom[joint];
+		targets[joint].position = playFrom[joint] + distance * playTick / playSpan;
+		targets[joint].velocity = distance * controlTicksPerSec / playSpan;
+		targets[joint].acceleration = 0;
+	}
+	playTick++;
+	lowerAngleTenths = targets[0].position;
+	upperAngleTenths = targets[1].position;
+	trackJoints(targets);
+}
+
+/**
+ * @brief prints how long the recording is and how it's stored
+ */
+void printRecording(){
+	unsigned int rate = recordRate ? recordRate : controlTicksPerSec;
+	printf("Recording %u samples, %lu ms, %u bytes, %u in EEPROM%s\n\r",
+			recordSamples, recordTicks * 1000 / rate, recordLength, recordSpilled,
+			recordRunning ? ", recording" : "");
+}
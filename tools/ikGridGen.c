@@ -0,0 +1,262 @@
+/** @brief generator for the PROGMEM inverse kinematics grid
+ *
+ * @file ikGridGen.c
+ *
+ * Host program (not part of the AVR build) that solves the arm IK in double
+ * precision over the conveyor workspace and writes include/ikGrid.h and
+ * ikGrid.c. Near the edge of reach the joint angles bend too fast for
+ * bilinear interpolation, so every cell is checked on a 1mm mesh and cells
+ * that miss the tolerance are flagged for the analytic solver instead. The
+ * error report lets the grid step be traded off against flash.
+ *
+ * Build and run from the project folder:
+ * 		gcc -o ikGridGen tools/ikGridGen.c -lm
+ * 		./ikGridGen [step in mm] [tolerance in degrees]
+ *
+ * @author cpbove@wpi.edu
+ * @date 6-Mar-2016
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ * @def LINK_1_Length
+ * length of Link 1 in mm, same as arm.h
+ * @def LINK_2_Length
+ * length of Link 2 in mm, same as arm.h
+ * @def LINK_3_Length
+ * length of Link 3 in mm, same as arm.h
+ */
+#define LINK_1_Length	144.10
+#define LINK_2_Length	151.13
+#define LINK_3_Length	154.75
+
+/**
+ * @def X_MIN
+ * smallest x covered by the grid in mm
+ * @def X_MAX
+ * largest x covered by the grid in mm
+ * @def Y_MIN
+ * smallest y covered by the grid in mm (Grab_Height in FSM.h)
+ * @def Y_MAX
+ * largest y covered by the grid in mm (Starting_Height in FSM.h)
+ * @def DEFAULT_STEP
+ * grid spacing in mm when none is given
+ * @def DEFAULT_TOLERANCE
+ * worst interpolation error in degrees a cell may have and still be used
+ * @def UNREACHABLE
+ * table value for a grid point the arm can't reach
+ */
+#define X_MIN 100
+#define X_MAX 320
+#define Y_MIN 120
+#define Y_MAX 251
+#define DEFAULT_STEP 10
+#define DEFAULT_TOLERANCE 0.25
+#define UNREACHABLE 32767
+
+/**
+ * @brief exact elbow up inverse kinematics, same solution as setPosition
+ * @param x desired x in mm
+ * @param y desired y in mm
+ * @param theta1 where to put joint 1 in degrees
+ * @param theta2 where to put joint 2 in degrees
+ *
+ * @return 0 if the point is out of reach
+ */
+int solveIK(double x, double y, double *theta1, double *theta2){
+	double _y = y - LINK_1_Length;
+	double rr = x * x + _y * _y;
+	double cosElbow = (rr - LINK_2_Length * LINK_2_Length - LINK_3_Length * LINK_3_Length)
+			/ (2 * LINK_2_Length * LINK_3_Length);
+	if(cosElbow > 1 || cosElbow < -1)
+		return 0;
+	double elbow = acos(cosElbow);
+	*theta1 = (atan2(_y, x) + atan2(LINK_3_Length * sin(elbow),
+			LINK_2_Length + LINK_3_Length * cos(elbow))) * 180 / M_PI;
+	*theta2 = 90 - elbow * 180 / M_PI;
+	return 1;
+}
+
+/**
+ * @brief worst bilinear interpolation error inside one grid cell
+ * @param grid the solved grid points
+ * @param cols number of grid columns
+ * @param step grid spacing in mm
+ * @param row row of the cell's lower left corner
+ * @param col column of the cell's lower left corner
+ * @param sumError adds the error of every mesh point to this
+ * @param samples adds the number of mesh points to this
+ *
+ * @return worst error in degrees on a 1mm mesh, -1 if the cell has an
+ * unreachable corner or point
+ */
+double cellError(int (*grid)[2], int cols, int step, int row, int col,
+		double *sumError, int *samples){
+	int *p00 = grid[row * cols + col];
+	int *p01 = grid[row * cols + col + 1];
+	int *p10 = grid[(row + 1) * cols + col];
+	int *p11 = grid[(row + 1) * cols + col + 1];
+	double maxError = 0, theta1, theta2;
+	int i, j, joint;
+
+	if(p00[0] == UNREACHABLE || p01[0] == UNREACHABLE
+			|| p10[0] == UNREACHABLE || p11[0] == UNREACHABLE)
+		return -1;
+	for(j = 0; j <= step; j++){
+		for(i = 0; i <= step; i++){
+			if(!solveIK(X_MIN + col * step + i, Y_MIN + row * step + j, &theta1, &theta2))
+				return -1;
+			double fx = (double)i / step;
+			double fy = (double)j / step;
+			for(joint = 0; joint < 2; joint++){
+				double interp = (p00[joint] * (1 - fx) * (1 - fy) + p01[joint] * fx * (1 - fy)
+						+ p10[joint] * (1 - fx) * fy + p11[joint] * fx * fy) / 10;
+				double error = fabs(interp - (joint ? theta2 : theta1));
+				if(error > maxError)
+					maxError = error;
+				*sumError += error;
+			}
+			*samples += 2;
+		}
+	}
+	return maxError;
+}
+
+/**
+ * @brief generates the grid files and prints the error report
+ */
+int main(int argc, char *argv[]){
+	int step = (argc > 1) ? atoi(argv[1]) : DEFAULT_STEP;
+	double tolerance = (argc > 2) ? atof(argv[2]) : DEFAULT_TOLERANCE;
+	if(step <= 0){
+		fprintf(stderr, "step must be a positive number of mm\n");
+		return 1;
+	}
+	int cols = (X_MAX - X_MIN + step - 1) / step + 1;
+	int rows = (Y_MAX - Y_MIN + step - 1) / step + 1;
+	int (*grid)[2] = malloc(sizeof(int[2]) * rows * cols);
+	int row, col;
+	double theta1, theta2;
+
+	// solve every grid point, rounded to tenths of a degree
+	for(row = 0; row < rows; row++){
+		for(col = 0; col < cols; col++){
+			int *point = grid[row * cols + col];
+			if(solveIK(X_MIN + col * step, Y_MIN + row * step, &theta1, &theta2)){
+				point[0] = lround(theta1 * 10);
+				point[1] = lround(theta2 * 10);
+			}
+			else {
+				point[0] = UNREACHABLE;
+				point[1] = UNREACHABLE;
+			}
+		}
+	}
+
+	// check every cell, only the ones inside tolerance get used
+	int cellBytes = (cols - 1 + 7) / 8;
+	unsigned char *cellOK = calloc((rows - 1) * cellBytes, 1);
+	double maxError = 0, sumError = 0;
+	int samples = 0, cellsUsed = 0;
+	for(row = 0; row < rows - 1; row++){
+		for(col = 0; col < cols - 1; col++){
+			double cellSum = 0;
+			int cellSamples = 0;
+			double error = cellError(grid, cols, step, row, col, &cellSum, &cellSamples);
+			if(error < 0 || error > tolerance)
+				continue;
+			cellOK[row * cellBytes + col / 8] |= 1 << (col % 8);
+			cellsUsed++;
+			sumError += cellSum;
+			samples += cellSamples;
+			if(error > maxError)
+				maxError = error;
+		}
+	}
+
+	// header with the grid shape
+	FILE *header = fopen("include/ikGrid.h", "w");
+	FILE *source = fopen("ikGrid.c", "w");
+	if(!header || !source){
+		fprintf(stderr, "run from the project folder so include/ can be found\n");
+		return 1;
+	}
+	fprintf(header, "/** @brief PROGMEM inverse kinematics grid\n *\n"
+			" * @file ikGrid.h\n *\n"
+			" * Generated by tools/ikGridGen.c with a %d mm step, do not edit by hand.\n"
+			" */\n\n#ifndef INCLUDE_IKGRID_H_\n#define INCLUDE_IKGRID_H_\n\n"
+			"#include <avr/pgmspace.h>\n\n"
+			"/**\n * @def IK_GRID_X_MIN\n * x of the first grid column in mm\n"
+			" * @def IK_GRID_Y_MIN\n * y of the first grid row in mm\n"
+			" * @def IK_GRID_STEP\n * grid spacing in mm\n"
+			" * @def IK_GRID_COLS\n * number of grid columns (x)\n"
+			" * @def IK_GRID_ROWS\n * number of grid rows (y)\n"
+			" * @def IK_GRID_UNREACHABLE\n * value of a grid point the arm can't reach\n"
+			" * @def IK_GRID_CELL_BYTES\n * bytes per row of ikGridCellOK\n */\n"
+			"#define IK_GRID_X_MIN %d\n#define IK_GRID_Y_MIN %d\n#define IK_GRID_STEP %d\n"
+			"#define IK_GRID_COLS %d\n#define IK_GRID_ROWS %d\n#define IK_GRID_UNREACHABLE %d\n"
+			"#define IK_GRID_CELL_BYTES %d\n\n"
+			"/**\n * @var ikGrid\n * joint 1 and joint 2 angles in tenths of a degree at each grid point\n"
+			" *\n * @var ikGridCellOK\n * bit per cell, set if interpolating it stays within %.2f degrees\n */\n"
+			"extern const int ikGrid[IK_GRID_ROWS][IK_GRID_COLS][2] PROGMEM;\n"
+			"extern const unsigned char ikGridCellOK[IK_GRID_ROWS - 1][IK_GRID_CELL_BYTES] PROGMEM;\n\n"
+			"#endif /* INCLUDE_IKGRID_H_ */\n",
+			step, X_MIN, Y_MIN, step, cols, rows, UNREACHABLE, cellBytes, tolerance);
+	fclose(header);
+
+	fprintf(source, "/** @brief PROGMEM inverse kinematics grid\n *\n"
+			" * @file ikGrid.c\n *\n"
+			" * Generated by tools/ikGridGen.c with a %d mm step, do not edit by hand.\n"
+			" */\n\n#include \"include/ikGrid.h\"\n\n"
+			"const int ikGrid[IK_GRID_ROWS][IK_GRID_COLS][2] PROGMEM = {\n", step);
+	for(row = 0; row < rows; row++){
+		fprintf(source, "\t// y = %d mm\n\t{", Y_MIN + row * step);
+		for(col = 0; col < cols; col++){
+			int *point = grid[row * cols + col];
+			fprintf(source, "%s{%d,%d}", col ? (col % 6 ? ", " : ",\n\t ") : "", point[0], point[1]);
+		}
+		fprintf(source, "}%s\n", row < rows - 1 ? "," : "");
+	}
+	fprintf(source, "};\n\nconst unsigned char ikGridCellOK[IK_GRID_ROWS - 1][IK_GRID_CELL_BYTES] PROGMEM = {\n");
+	for(row = 0; row < rows - 1; row++){
+		fprintf(source, "\t{");
+		for(col = 0; col < cellBytes; col++)
+			fprintf(source, "%s0x%02X", col ? ", " : "", cellOK[row * cellBytes + col]);
+		fprintf(source, "}%s\n", row < rows - 2 ? "," : "");
+	}
+	fprintf(source, "};\n");
+	fclose(source);
+
+	// report on the whole workspace, counting what falls back to the solver
+	int reachable = 0, fallbacks = 0;
+	double x, y;
+	for(y = Y_MIN; y <= Y_MAX; y += 1){
+		for(x = X_MIN; x <= X_MAX; x += 1){
+			if(!solveIK(x, y, &theta1, &theta2))
+				continue;
+			reachable++;
+			col = (x - X_MIN) / step;
+			row = (y - Y_MIN) / step;
+			if(col >= cols - 1)
+				col = cols - 2;
+			if(row >= rows - 1)
+				row = rows - 2;
+			if(!(cellOK[row * cellBytes + col / 8] & (1 << (col % 8))))
+				fallbacks++;
+		}
+	}
+	printf("step %d mm: %d x %d grid, %d bytes of flash\n", step, cols, rows,
+			(int)(rows * cols * 2 * sizeof(short) + (rows - 1) * cellBytes));
+	printf("%d of %d cells within %.2f deg: max %.3f deg, mean %.3f deg\n",
+			cellsUsed, (rows - 1) * (cols - 1), tolerance, maxError,
+			samples ? sumError / samples : 0);
+	printf("%d of %d reachable 1mm points fall back to the analytic solver\n",
+			fallbacks, reachable);
+	free(cellOK);
+	free(grid);
+	return 0;
+}
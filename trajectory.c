@@ -0,0 +1,239 @@
+/** @brief joint space trajectories
+ *
+ * @file trajectory.c
+ *
+ * A minimum jerk move of distance d over time T follows
+ * d (10 tau^3 - 15 tau^4 + 6 tau^5) with tau = t / T, so it starts and ends
+ * at rest with no acceleration. The velocity is 30 d / T (tau (1 - tau))^2
+ * and the acceleration 60 d / T^2 tau (1 - tau) (1 - 2 tau). planTrajectory
+ * works out each joint's d / T scales once, stepTrajectory runs the shapes on
+ * tau in fixed point every tick and scales them for each joint.
+ *
+ * A trapezoidal move is as fast as the limits allow but jerks at the corners.
+ * planTrapezoid works out each joint's speed up time and cruise rate, and
+ * stepTrajectory integrates them in closed form every tick.
+ *
+ * @author cpbove@wpi.edu
+ * @date 11-Mar-2016
+ * @version 1.0
+ */
+
+#include "RBELib/RBELib.h"
+#include "include/definitions.h"
+#include "include/arm.h"
+#include "include/trajectory.h"
+#include "math.h"
+
+/**
+ * @var trajMaxVelocity
+ * fastest each joint is planned to move in tenths of a degree per second
+ *
+ * @var trajMaxAccel
+ * hardest each joint is planned to accelerate in tenths of a degree per second^2
+ */
+const unsigned int trajMaxVelocity[PID_NUM_JOINTS] = {TRAJ_JOINT_1_MAX_VELOCITY, TRAJ_JOINT_2_MAX_VELOCITY};
+const unsigned int trajMaxAccel[PID_NUM_JOINTS] = {TRAJ_JOINT_1_MAX_ACCEL, TRAJ_JOINT_2_MAX_ACCEL};
+
+/**
+ * @brief plans a minimum jerk move of both joints
+ * @details the duration is the shortest that keeps every joint inside its
+ * velocity and acceleration limits, at the current control rate
+ * @param traj trajectory to plan, it starts at its first tick
+ * @param start angle of each joint now, joint 1 first
+ * @param end angle of each joint at the end of the move
+ *
+ * @return length of the move in control ticks
+ */
+unsigned int planTrajectory(jointTrajectory *traj, const int *start, const int *end){
+	float seconds = 0;
+	int joint;
+
+	// peak velocity of the move is 1.875 d / T, peak acceleration 5.7735 d / T^2
+	for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+		float distance = fabs(end[joint] - start[joint]);
+		float t = 1.875 * distance / trajMaxVelocity[joint];
+		if(t > seconds)
+			seconds = t;
+		t = sqrt(5.7735 * distance / trajMaxAccel[joint]);
+		if(t > seconds)
+			seconds = t;
+	}
+
+	// whole ticks, rounded up so the limits still hold
+	traj->duration = ceil(seconds * controlTicksPerSec);
+	if(traj->duration < 1)
+		traj->duration = 1;
+	seconds = (float)traj->duration / controlTicksPerSec;
+
+	for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+		quinticJoint *q = &traj->quintic[joint];
+		float rate = (end[joint] - start[joint]) / seconds;
+		traj->start[joint] = start[joint];
+		traj->end[joint] = end[joint];
+		q->distance = end[joint] - start[joint];
+		q->velocity = lround(30 * rate);
+		q->acceleration = lround(60 * rate / seconds);
+	}
+	traj->profile = TRAJ_MIN_JERK;
+	traj->tick = 0;
+	traj->active = TRUE;
+	return traj->duration;
+}
+
+/**
+ * @brief plans the fastest trapezoidal move of both joints that ends with
+ * both together
+ * @details the slowest joint sets the duration, flat out on its limits. The
+ * others keep their acceleration limit and cruise just fast enough to
+ * finish at the same time.
+ * @param traj trajectory to plan, it starts at its first tick
+ * @param start angle of each joint now, joint 1 first
+ * @param end angle of each joint at the end of the move
+ *
+ * @return length of the move in control ticks
+ */
+unsigned int planTrapezoid(jointTrajectory *traj, const int *start, const int *end){
+	float ticks = 0;
+	int joint;
+
+	// fastest each joint can make it on its own, in ticks: up to speed, cruise
+	// and back down, or a triangle if it never gets up to speed
+	for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+		float distance = fabs(end[joint] - start[joint]);
+		float rate = (float)trajMaxVelocity[joint] / controlTicksPerSec;
+		float accel = (float)trajMaxAccel[joint] / controlTicksPerSec / controlTicksPerSec;
+		float t;
+		if(distance >= rate * rate / accel)
+			t = distance / rate + rate / accel;
+		else
+			t = 2 * sqrt(distance / accel);
+		if(t > ticks)
+			ticks = t;
+	}
+	traj->duration = ceil(ticks);
+	if(traj->duration < 2)
+		traj->duration = 2;
+
+	for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+		trapezoidJoint *p = &traj->trapezoid[joint];
+		float distance = end[joint] - start[joint];
+		float accel = (float)trajMaxAccel[joint] / controlTicksPerSec / controlTicksPerSec;
+		float duration = traj->duration;
+		// cruise rate that covers the distance in the duration at full
+		// acceleration: distance = rate (duration - rate / accel)
+		float root = accel * accel * duration * duration - 4 * accel * fabs(distance);
+		float rate = (accel * duration - sqrt(root > 0 ? root : 0)) / 2;
+		// whole ticks of speeding up, a bit longer is a bit gentler, then
+		// the cruise rate makes up the distance exactly
+		unsigned int accelTicks = ceil(rate / accel);
+		if(accelTicks > traj->duration / 2)
+			accelTicks = traj->duration / 2;
+		if(accelTicks < 1)
+			accelTicks = 1;
+		float cruise = distance / (traj->duration - accelTicks);
+
+		p->accelTicks = accelTicks;
+		p->cruise = lround(cruise * (1L << TRAJ_VELOCITY_SHIFT));
+		p->cruiseRate = lround(cruise * controlTicksPerSec);
+		p->accelRate = lround(cruise * controlTicksPerSec * controlTicksPerSec / accelTicks);
+		traj->start[joint] = start[joint];
+		traj->end[joint] = end[joint];
+	}
+	traj->profile = TRAJ_TRAPEZOID;
+	traj->tick = 0;
+	traj->active = TRUE;
+	return traj->duration;
+}
+
+/**
+ * @brief gets one joint's setpoint on a trapezoidal move
+ * @param traj trajectory the joint is on
+ * @param joint 0 for joint 1, 1 for joint 2
+ * @param target where to put the angle, velocity and acceleration
+ */
+void stepTrapezoidJoint(const jointTrajectory *traj, int joint, jointTarget *target){
+	const trapezoidJoint *p = &traj->trapezoid[joint];
+	unsigned int t = traj->tick;
+	unsigned int left = traj->duration - t;
+	const unsigned char shift = TRAJ_VELOCITY_SHIFT + 1; // the halves below
+	const long half = 1L << (shift - 1); // round to the nearest tenth
+
+	if(t < p->accelTicks){
+		// speeding up: cruise t^2 / (2 accelTicks)
+		target->position = traj->start[joint] + ((p->cruise * t / p->accelTicks * t + half) >> shift);
+		target->velocity = (long)p->cruiseRate * t / p->accelTicks;
+		target->acceleration = p->accelRate;
+	}
+	else if(left >= p->accelTicks){
+		// cruising: half the speed up distance, then cruise from there
+		target->position = traj->start[joint] + ((p->cruise * (2L * t - p->accelTicks) + half) >> shift);
+		target->velocity = p->cruiseRate;
+		target->acceleration = 0;
+	}
+	else{
+		// slowing down, the speed up backwards from the end
+		target->position = traj->end[joint] - ((p->cruise * left / p->accelTicks * left + half) >> shift);
+		target->velocity = (long)p->cruiseRate * left / p->accelTicks;
+		target->acceleration = -p->accelRate;
+	}
+}
+
+/**
+ * @brief gets the setpoints for this tick and moves the trajectory on one
+ * @param traj trajectory to step
+ * @param targets where to put each joint's angle, velocity and acceleration
+ *
+ * @return FALSE once the move is over, the targets then hold the end angles
+ */
+BOOL stepTrajectory(jointTrajectory *traj, jointTarget *targets){
+	int joint;
+	if(!traj->active){
+		for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+			targets[joint].position = traj->end[joint];
+			targets[joint].velocity = 0;
+			targets[joint].acceleration = 0;
+		}
+		return FALSE;
+	}
+
+	if(traj->profile == TRAJ_TRAPEZOID){
+		for(joint = 0; joint < PID_NUM_JOINTS; joint++)
+			stepTrapezoidJoint(traj, joint, &targets[joint]);
+	}
+	else{
+		// the shapes are the same for every joint, only the scales differ
+		const long one = 1L << TRAJ_TAU_SHIFT;
+		long tau = ((long)traj->tick << TRAJ_TAU_SHIFT) / traj->duration;
+		long tau2 = (tau * tau) >> TRAJ_TAU_SHIFT;
+		long tau3 = (tau2 * tau) >> TRAJ_TAU_SHIFT;
+		// 10 - 15 tau + 6 tau^2 is always positive, up to 10, so unsigned
+		unsigned long poly = 10 * one - 15 * tau + 6 * tau2;
+		long shape = (poly * tau3) >> TRAJ_TAU_SHIFT;
+		long bump = (tau * (one - tau)) >> TRAJ_TAU_SHIFT; // up to a quarter
+		long bump2 = (bump * bump) >> TRAJ_TAU_SHIFT;
+		long slope = (bump * (one - 2 * tau)) >> TRAJ_TAU_SHIFT;
+		for(joint = 0; joint < PID_NUM_JOINTS; joint++){
+			const quinticJoint *q = &traj->quintic[joint];
+			targets[joint].position = traj->start[joint]
+					+ (((long)q->distance * shape + (one >> 1)) >> TRAJ_TAU_SHIFT);
+			targets[joint].velocity = (q->velocity * bump2) >> TRAJ_TAU_SHIFT;
+			targets[joint].acceleration = (q->acceleration * slope) >> TRAJ_TAU_SHIFT;
+		}
+	}
+	// the last tick gives out the end angles, then the move is over
+	if(++traj->tick > traj->duration)
+		traj->active = FALSE;
+	return TRUE;
+}
+
+/**
+ * @brief gets how much of a move is left
+ * @param traj trajectory to check
+ *
+ * @return control ticks until the move ends, 0 if it is over
+ */
+unsigned int trajectoryTicksLeft(const jointTrajectory *traj){
+	if(!traj->active)
+		return 0;
+	return traj->duration + 1 - traj->tick;
+}